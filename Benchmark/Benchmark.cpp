@@ -0,0 +1,398 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "HallReverb.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace
+{
+const float sampleRates[] = {44100.0f, 48000.0f, 96000.0f, 192000.0f};
+const int blockSizes[] = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096};
+
+struct Options
+{
+    double seconds = 10.0;
+    float sampleRate = 0.0f; // 0 = all sample rates
+    int blockSize = 0;       // 0 = all block sizes
+    bool profile = false;
+    bool tail = false;
+    bool automation = false;
+    HallReverb::ChannelLayout layout = HallReverb::ChannelLayout::stereo;
+    int numLateDelays = 8;
+    bool downsampleLate = false;
+};
+
+struct LayoutName
+{
+    const char* name;
+    HallReverb::ChannelLayout layout;
+};
+
+const LayoutName layoutNames[] = {
+    {"stereo", HallReverb::ChannelLayout::stereo},
+    {"quad", HallReverb::ChannelLayout::quad},
+    {"5.1", HallReverb::ChannelLayout::surround51},
+    {"7.1", HallReverb::ChannelLayout::surround71},
+    {"ambisonic", HallReverb::ChannelLayout::ambisonic},
+};
+
+struct Result
+{
+    double nsPerSample;
+    double realtimeFactor;
+    double instancesPerCore;
+    HallReverb::Profile profile;
+};
+
+void printUsage(const char* name)
+{
+    std::printf("usage: %s [--seconds <s>] [--rate <Hz>] [--block <samples>] [--profile] [--tail] [--automation]\n", name);
+    std::printf("       [--layout <stereo|quad|5.1|7.1|ambisonic>] [--delays <4|8|16|32>] [--downsample]\n");
+    std::printf("  --seconds  length of the processed audio per run (default: 10)\n");
+    std::printf("  --rate     run only the given sample rate (default: 44100, 48000, 96000, 192000)\n");
+    std::printf("  --block    run only the given block size (default: 16 ... 4096)\n");
+    std::printf("  --profile  print the time spent in each stage of HallReverb::process\n");
+    std::printf("  --tail     process a long decaying tail and fail if it slows down (default: 48000 Hz, 256 samples)\n");
+    std::printf("  --automation  process scheduled parameter changes and fail if the output differs from splitting the\n");
+    std::printf("             blocks at the changes (default: 48000 Hz, 512 samples)\n");
+    std::printf("  --layout   process all channels of a multichannel layout in place (default: stereo)\n");
+    std::printf("  --delays   number of delay lines of the late reverb (default: 8)\n");
+    std::printf("  --downsample  run the late reverb at 44.1 or 48 kHz at higher sample rates\n");
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            options.seconds = std::atof(argv[++i]);
+        else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+            options.sampleRate = static_cast<float>(std::atof(argv[++i]));
+        else if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc)
+            options.blockSize = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--profile") == 0)
+            options.profile = true;
+        else if (std::strcmp(argv[i], "--tail") == 0)
+            options.tail = true;
+        else if (std::strcmp(argv[i], "--automation") == 0)
+            options.automation = true;
+        else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc)
+        {
+            const char* name = argv[++i];
+            const auto* layoutName = std::find_if(std::begin(layoutNames), std::end(layoutNames),
+                                                  [name](const LayoutName& l) { return std::strcmp(l.name, name) == 0; });
+            if (layoutName == std::end(layoutNames))
+                return false;
+            options.layout = layoutName->layout;
+        }
+        else if (std::strcmp(argv[i], "--delays") == 0 && i + 1 < argc)
+            options.numLateDelays = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--downsample") == 0)
+            options.downsampleLate = true;
+        else
+            return false;
+    }
+    const bool validDelays = options.numLateDelays == 4 || options.numLateDelays == 8 || options.numLateDelays == 16 ||
+                             options.numLateDelays == 32;
+    return options.seconds > 0.0 && options.sampleRate >= 0.0f && options.blockSize >= 0 && validDelays;
+}
+
+void fillNoise(std::vector<float>& buffer, unsigned int seed)
+{
+    // deterministic white noise in the range -0.5 ... 0.5
+    for (auto& sample : buffer)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        sample = static_cast<float>(seed >> 8) / 16777216.0f - 0.5f;
+    }
+}
+
+Result runBenchmark(float sampleRate, int blockSize, double seconds, bool profile, HallReverb::ChannelLayout layout,
+                    int numLateDelays, bool downsampleLate)
+{
+    // one second of noise is cycled through to keep the input out of the cache measurements
+    const int inputLength = static_cast<int>(sampleRate) / blockSize * blockSize;
+    std::vector<float> leftIn(inputLength), rightIn(inputLength);
+    std::vector<float> leftOut(blockSize), rightOut(blockSize);
+    fillNoise(leftIn, 1u);
+    fillNoise(rightIn, 2u);
+
+    auto reverb = std::make_unique<HallReverb>();
+    reverb->setLateDownsampling(downsampleLate);
+    reverb->setSampleRate(sampleRate);
+    reverb->setChannelLayout(layout);
+    reverb->setNumLateDelays(numLateDelays);
+    reverb->setProfilingEnabled(profile);
+
+    // the multichannel layouts are processed in place, every channel gets the noise of its side
+    const int numChannels = HallReverb::getNumChannels(layout);
+    std::vector<std::vector<float>> channels(numChannels, std::vector<float>(blockSize));
+    std::vector<float*> channelPointers;
+    for (auto& channel : channels)
+        channelPointers.push_back(channel.data());
+
+    const long long numBlocks = static_cast<long long>(seconds * sampleRate) / blockSize;
+    const int numWarmUpBlocks = inputLength / blockSize / 2;
+    int position = 0;
+
+    auto processBlock = [&]() {
+        if (layout == HallReverb::ChannelLayout::stereo)
+            reverb->process(&leftIn[position], &rightIn[position], leftOut.data(), rightOut.data(), blockSize);
+        else
+        {
+            for (int c = 0; c < numChannels; ++c)
+                std::copy_n(c % 2 == 0 ? &leftIn[position] : &rightIn[position], blockSize, channels[c].data());
+            reverb->process(channelPointers.data(), blockSize);
+        }
+        position += blockSize;
+        if (position >= inputLength)
+            position = 0;
+    };
+
+    for (int i = 0; i < numWarmUpBlocks; ++i)
+        processBlock();
+    reverb->resetProfile();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (long long i = 0; i < numBlocks; ++i)
+        processBlock();
+    const auto stop = std::chrono::steady_clock::now();
+
+    const double elapsedSeconds = std::chrono::duration<double>(stop - start).count();
+    const double audioSeconds = static_cast<double>(numBlocks * blockSize) / sampleRate;
+
+    Result result;
+    result.nsPerSample = elapsedSeconds * 1e9 / static_cast<double>(numBlocks * blockSize);
+    result.realtimeFactor = elapsedSeconds / audioSeconds;
+    result.instancesPerCore = audioSeconds / elapsedSeconds;
+    result.profile = reverb->getProfile();
+    return result;
+}
+
+bool runTailBenchmark(float sampleRate, int blockSize, double seconds)
+{
+    // Half a second of noise is followed by silence, so the late reverb decays from full scale through the denormal
+    // range before the silence detection bypasses it. Without flush-to-zero the tail gets more than ten times slower,
+    // the UNDENORMAL() checks alone make it up to two times slower.
+    const float decay = 2.0f;
+    const int windowLength = static_cast<int>(sampleRate) / 2 / blockSize * blockSize;
+    const int numWindows = static_cast<int>(seconds * 2.0);
+    const double maxSlowdown = 3.0;
+    std::vector<float> leftIn(windowLength), rightIn(windowLength);
+    std::vector<float> leftOut(blockSize), rightOut(blockSize);
+    fillNoise(leftIn, 1u);
+    fillNoise(rightIn, 2u);
+
+    auto reverb = std::make_unique<HallReverb>();
+    reverb->setSampleRate(sampleRate);
+    reverb->setLateDecay(decay);
+
+    std::printf("tail with %.1f s decay at %.0f Hz, block size %d\n", decay, sampleRate, blockSize);
+    std::printf("%10s %12s %14s\n", "time [s]", "ns/sample", "peak [dBFS]");
+    double inputNsPerSample = 0.0;
+    double slowestNsPerSample = 0.0;
+    for (int window = 0; window < numWindows; ++window)
+    {
+        float peak = 0.0f;
+        const auto start = std::chrono::steady_clock::now();
+        for (int position = 0; position < windowLength; position += blockSize)
+        {
+            reverb->process(&leftIn[position], &rightIn[position], leftOut.data(), rightOut.data(), blockSize);
+            for (int i = 0; i < blockSize; ++i)
+                peak = std::max(peak, std::max(std::fabs(leftOut[i]), std::fabs(rightOut[i])));
+        }
+        const auto stop = std::chrono::steady_clock::now();
+
+        const double nsPerSample = std::chrono::duration<double>(stop - start).count() * 1e9 / windowLength;
+        std::printf("%10.1f %12.2f %14.1f\n", window * 0.5, nsPerSample,
+                    peak > 0.0f ? 20.0 * std::log10(static_cast<double>(peak)) : -std::numeric_limits<double>::infinity());
+        std::fflush(stdout);
+
+        if (window == 0)
+        {
+            inputNsPerSample = nsPerSample;
+            std::fill(leftIn.begin(), leftIn.end(), 0.0f);
+            std::fill(rightIn.begin(), rightIn.end(), 0.0f);
+        }
+        else
+            slowestNsPerSample = std::max(slowestNsPerSample, nsPerSample);
+    }
+
+    const double slowdown = slowestNsPerSample / inputNsPerSample;
+    const bool passed = slowdown < maxSlowdown;
+    std::printf("slowest tail window: %.2fx the time of the input window (%s, limit %.1fx)\n", slowdown,
+                passed ? "passed" : "FAILED", maxSlowdown);
+    return passed;
+}
+
+bool runAutomationCheck(float sampleRate, int blockSize, double seconds)
+{
+    // One reverb gets the changes through scheduleParameter() for each block, the other one processes the blocks split
+    // at the changes and gets them through setParameter() before each part. Both must give the same output. The changes
+    // cycle through all parameters with random values in their ranges, a few of them at the same offset.
+    struct Change
+    {
+        int position;
+        HallReverb::Parameter parameter;
+        float newValue;
+    };
+    const int length = static_cast<int>(seconds * sampleRate) / blockSize * blockSize;
+    std::vector<float> leftIn(length), rightIn(length);
+    std::vector<float> scheduledLeft(length), scheduledRight(length), splitLeft(length), splitRight(length);
+    fillNoise(leftIn, 1u);
+    fillNoise(rightIn, 2u);
+
+    std::vector<Change> changes;
+    unsigned int seed = 3u;
+    auto random = [&seed](int range) {
+        seed = seed * 1664525u + 1013904223u;
+        return static_cast<int>((seed >> 8) % static_cast<unsigned int>(range));
+    };
+    for (int position = random(blockSize), index = 0; position < length; position += random(2 * blockSize), ++index)
+    {
+        const auto parameter = static_cast<HallReverb::Parameter>(index % HallReverb::numParameters);
+        const float minimum = HallReverb::getParameterMinimum(parameter);
+        const float maximum = HallReverb::getParameterMaximum(parameter);
+        changes.push_back({position, parameter, minimum + (maximum - minimum) * static_cast<float>(random(1001)) / 1000.0f});
+    }
+
+    auto scheduled = std::make_unique<HallReverb>();
+    auto split = std::make_unique<HallReverb>();
+    scheduled->setSampleRate(sampleRate);
+    split->setSampleRate(sampleRate);
+
+    std::size_t next = 0;
+    const auto scheduledStart = std::chrono::steady_clock::now();
+    for (int position = 0; position < length; position += blockSize)
+    {
+        for (; next < changes.size() && changes[next].position < position + blockSize; ++next)
+            scheduled->scheduleParameter(changes[next].parameter, changes[next].newValue, changes[next].position - position);
+        scheduled->process(&leftIn[position], &rightIn[position], &scheduledLeft[position], &scheduledRight[position],
+                           blockSize);
+    }
+    const auto scheduledStop = std::chrono::steady_clock::now();
+
+    next = 0;
+    const auto splitStart = std::chrono::steady_clock::now();
+    for (int position = 0; position < length; position += blockSize)
+    {
+        for (int start = position; start < position + blockSize;)
+        {
+            for (; next < changes.size() && changes[next].position == start; ++next)
+                split->setParameter(changes[next].parameter, changes[next].newValue);
+            const int end = next < changes.size() ? std::min(changes[next].position, position + blockSize)
+                                                  : position + blockSize;
+            split->process(&leftIn[start], &rightIn[start], &splitLeft[start], &splitRight[start], end - start);
+            start = end;
+        }
+    }
+    const auto splitStop = std::chrono::steady_clock::now();
+
+    float maxDifference = 0.0f;
+    for (int i = 0; i < length; ++i)
+        maxDifference = std::max(maxDifference, std::max(std::fabs(scheduledLeft[i] - splitLeft[i]),
+                                                         std::fabs(scheduledRight[i] - splitRight[i])));
+
+    const bool passed = maxDifference == 0.0f;
+    std::printf("%zu scheduled changes at %.0f Hz, block size %d\n", changes.size(), sampleRate, blockSize);
+    std::printf("%10s %12s\n", "", "ns/sample");
+    std::printf("%10s %12.2f\n", "scheduled",
+                std::chrono::duration<double>(scheduledStop - scheduledStart).count() * 1e9 / length);
+    std::printf("%10s %12.2f\n", "split",
+                std::chrono::duration<double>(splitStop - splitStart).count() * 1e9 / length);
+    std::printf("largest difference to the split blocks: %g (%s)\n", static_cast<double>(maxDifference),
+                passed ? "passed" : "FAILED");
+    return passed;
+}
+
+void printProfile(const HallReverb::Profile& profile)
+{
+    const double numSamples = static_cast<double>(profile.numSamples);
+    const double total = static_cast<double>(profile.parameters + profile.inputPeak + profile.early + profile.late + profile.bypass);
+    if (numSamples == 0.0 || total == 0.0)
+        return;
+
+    auto printStage = [&](const char* stage, std::uint64_t time) {
+        std::printf("%20s %12.2f ns/sample %6.1f %%\n", stage, static_cast<double>(time) / numSamples,
+                    100.0 * static_cast<double>(time) / total);
+    };
+    printStage("parameters", profile.parameters);
+    printStage("input peak", profile.inputPeak);
+    printStage("early reflections", profile.early);
+    printStage("late reverb and mix", profile.late);
+    printStage("bypass", profile.bypass);
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.tail)
+        return runTailBenchmark(options.sampleRate > 0.0f ? options.sampleRate : 48000.0f,
+                                options.blockSize > 0 ? options.blockSize : 256, options.seconds)
+                   ? 0
+                   : 1;
+
+    if (options.automation)
+        return runAutomationCheck(options.sampleRate > 0.0f ? options.sampleRate : 48000.0f,
+                                  options.blockSize > 0 ? options.blockSize : 512, options.seconds)
+                   ? 0
+                   : 1;
+
+    std::vector<float> rates(std::begin(sampleRates), std::end(sampleRates));
+    if (options.sampleRate > 0.0f)
+        rates.assign(1, options.sampleRate);
+    std::vector<int> blocks(std::begin(blockSizes), std::end(blockSizes));
+    if (options.blockSize > 0)
+        blocks.assign(1, options.blockSize);
+
+    std::printf("%10s %8s %12s %12s %14s\n", "rate [Hz]", "block", "ns/sample", "RT factor", "instances/core");
+    for (float sampleRate : rates)
+    {
+        for (int blockSize : blocks)
+        {
+            const Result result = runBenchmark(sampleRate, blockSize, options.seconds, options.profile, options.layout,
+                                               options.numLateDelays, options.downsampleLate);
+            std::printf("%10.0f %8d %12.2f %12.5f %14.1f\n",
+                        sampleRate, blockSize, result.nsPerSample,
+                        result.realtimeFactor, result.instancesPerCore);
+            if (options.profile)
+                printProfile(result.profile);
+            std::fflush(stdout);
+        }
+    }
+
+    return 0;
+}
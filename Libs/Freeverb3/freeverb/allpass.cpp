@@ -106,9 +106,9 @@ fv3_float_t FV3_(allpass)::getdecay()
 
 FV3_(allpassm)::FV3_(allpassm)()
 {
-  bufsize = readidx = writeidx = modulationsize = 0;
+  bufsize = bufmask = readidx = writeidx = delaysize = modulationsize = 0;
   feedback = feedback_mod = z_1 = modulationsize_f = 0;
-  buffer = NULL; decay = 1;
+  buffer = NULL; ownbuffer = true; decay = 1;
 }
 
 FV3_(allpassm)::FV3_(~allpassm)()
@@ -118,12 +118,12 @@ FV3_(allpassm)::FV3_(~allpassm)()
 
 long FV3_(allpassm)::getsize()
 {
-  return bufsize;
+  return delaysize + modulationsize;
 }
 
 long FV3_(allpassm)::getdelaysize()
 {
-  return (bufsize - modulationsize);
+  return delaysize;
 }
 
 long FV3_(allpassm)::getmodulationsize()
@@ -141,36 +141,62 @@ void FV3_(allpassm)::setsize(long size, long modsize)
 #ifdef FVDEBUG
   std::fprintf(stderr, "allpassm::setsize(%ld,%ld)\n", size, modsize);
 #endif
+  if(size <= 0) return;
+  if(modsize < 0) modsize = 0;
+  if(modsize > size) modsize = size;
+  setmaxsize(size, modsize);
+
+  // The buffer is a ring of bufsize samples and the delay is the distance
+  // between the read and the write position, so a shorter delay than the
+  // buffer only moves the read position and keeps the delayed signal.
+  delaysize = size;
+  modulationsize = modsize;
+  modulationsize_f = (fv3_float_t)modulationsize;
+  readidx = writeidx - (delaysize - modulationsize); if(readidx < 0) readidx += bufsize;
+}
+
+void FV3_(allpassm)::setmaxsize(long size, long modsize)
+{
   if(size <= 0) return;
   if(modsize < 0) modsize = 0;
   if(modsize > size) modsize = size;
   long newsize = size + modsize;
+#ifdef ENABLE_POW2_DELAY
+  newsize = FV3_(utils)::checkPow2(newsize);
+#endif
+  if(newsize <= bufsize) return;
   fv3_float_t * new_buffer = NULL;
   new_buffer = new fv3_float_t[newsize];
   FV3_(utils)::mute(new_buffer, newsize);
-  
-  this->free();
-  bufsize = newsize;
-  readidx = modsize * 2;
-  writeidx = 0;
-  modulationsize = modsize;
-  modulationsize_f = (fv3_float_t)modulationsize;
-  buffer = new_buffer;
-  z_1 = 0;
+
+  if(buffer != NULL&&ownbuffer) delete[] buffer;
+  buffer = new_buffer; ownbuffer = true;
+  bufsize = newsize; bufmask = newsize-1;
+  writeidx = 0; z_1 = 0;
+  readidx = bufsize - (delaysize - modulationsize); if(readidx >= bufsize) readidx -= bufsize;
 }
 
 void FV3_(allpassm)::free()
 {
   if(buffer == NULL||bufsize == 0) return;
-  delete[] buffer;
-  buffer = NULL; writeidx = bufsize = 0; z_1 = 0;
+  if(ownbuffer) delete[] buffer;
+  buffer = NULL; readidx = writeidx = bufsize = bufmask = delaysize = modulationsize = 0; z_1 = 0; ownbuffer = true;
+}
+
+void FV3_(allpassm)::setbuffer(fv3_float_t * buf, long size)
+{
+  if(buf == NULL||size < bufsize||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = buf; ownbuffer = false;
+  mute();
 }
 
 void FV3_(allpassm)::mute()
 {
   if(buffer == NULL||bufsize == 0) return;
   FV3_(utils)::mute(buffer, bufsize);
-  writeidx = 0; z_1 = 0; readidx = modulationsize * 2; feedback_mod = feedback;
+  writeidx = 0; z_1 = 0; feedback_mod = feedback;
+  readidx = bufsize - (delaysize - modulationsize); if(readidx >= bufsize) readidx -= bufsize;
 }
 
 void FV3_(allpassm)::setfeedback(fv3_float_t val) 
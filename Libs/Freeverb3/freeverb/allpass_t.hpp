@@ -144,11 +144,32 @@ class _FV3_(allpassm)
   void free();
 
   /**
-   * Set delay size. This does not preserve previous data.
+   * Set delay size. The buffer is only reallocated (and cleared) if it is
+   * smaller than size+modsize, otherwise only the read position is moved.
    * @param[in] size The delay size.
+   * @param[in] modsize The modulation size.
    */
   void setsize(long size);
   void setsize(long size, long modsize);
+
+  /**
+   * Allocate the buffer for delay sizes up to size+modsize, so that later
+   * setsize() calls within this size do not allocate memory.
+   * @param[in] size The maximum delay size.
+   * @param[in] modsize The maximum modulation size.
+   */
+  void setmaxsize(long size, long modsize);
+
+  /**
+   * Use external memory (see arena) instead of an own buffer. The buffer is
+   * cleared and not freed by this object. Resizing beyond getbufsize()
+   * allocates an own buffer again.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] size The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long size);
+  long getbufsize(){ return bufsize; }
+
   long getsize();
   long getdelaysize();
   long getmodulationsize();
@@ -180,16 +201,16 @@ class _FV3_(allpassm)
     _fv3_float_t floor_mod = std::floor(modulation); // >= 0
     _fv3_float_t m_frac = 1. - (modulation - floor_mod); // >= 0
     
-    long readidx_a = readidx - (long)floor_mod; if(readidx_a < 0) readidx_a += bufsize;
-    long readidx_b = readidx_a - 1; if(readidx_b < 0) readidx_b += bufsize;
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
 
     z_1 = buffer[readidx_b] + m_frac * (buffer[readidx_a] - z_1);
     UNDENORMAL(z_1);
-    readidx ++; if(readidx >= bufsize) readidx = 0;
+    readidx = _wraph(readidx + 1);
 
     buffer[writeidx] = input + z_1 * feedback_mod;
     input = z_1 - buffer[writeidx] * feedback_mod;
-    writeidx ++; if(writeidx >= bufsize) writeidx = 0;
+    writeidx = _wraph(writeidx + 1);
 
     return input;
   }
@@ -232,16 +253,16 @@ class _FV3_(allpassm)
     _fv3_float_t floor_mod = std::floor(modulation); // >= 0
     _fv3_float_t m_frac = 1. - (modulation - floor_mod); // >= 0
     
-    long readidx_a = readidx - (long)floor_mod; if(readidx_a < 0) readidx_a += bufsize;
-    long readidx_b = readidx_a - 1; if(readidx_b < 0) readidx_b += bufsize;
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
     
     z_1 = buffer[readidx_b] + m_frac * (buffer[readidx_a] - z_1);
     UNDENORMAL(z_1);
-    readidx ++; if(readidx >= bufsize) readidx = 0;
+    readidx = _wraph(readidx + 1);
 
     buffer[writeidx] = input + z_1 * feedback_mod;
     input = decay * z_1 - buffer[writeidx] * feedback_mod;
-    writeidx ++; if(writeidx >= bufsize) writeidx = 0;
+    writeidx = _wraph(writeidx + 1);
     
     return input;
   }
@@ -275,15 +296,15 @@ class _FV3_(allpassm)
     _fv3_float_t floor_mod = std::floor(modulation); // >= 0
     _fv3_float_t frac = modulation - floor_mod; // >= 0
     
-    long readidx_a = readidx - (long)floor_mod; if(readidx_a < 0) readidx_a += bufsize;
-    long readidx_b = readidx_a - 1; if(readidx_b < 0) readidx_b += bufsize;
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
 
     _fv3_float_t temp = buffer[readidx_b]*frac + buffer[readidx_a]*(1.-frac);
-    readidx ++; if(readidx >= bufsize) readidx = 0;
+    readidx = _wraph(readidx + 1);
 
     buffer[writeidx] = input + temp * feedback_mod;
     input = temp - buffer[writeidx] * feedback_mod;
-    writeidx ++; if(writeidx >= bufsize) writeidx = 0;
+    writeidx = _wraph(writeidx + 1);
     
     return input;
   }
@@ -307,11 +328,54 @@ class _FV3_(allpassm)
     return _process_li(input,modulation);
   }
  
+  inline _fv3_float_t _getlast(){ return z_1; }
+  inline void _setlast(_fv3_float_t value){ z_1 = value; }
+
+  /**
+   * The read half of _process() for vectorized callers, which keep z_1 themselves.
+   * @param[in] modulation The delayline modulation difference. This must be -1~+1.
+   * @param[out] a The sample at the modulated read position.
+   * @param[out] b The sample before the modulated read position.
+   * @param[out] frac The allpass interpolation coefficient.
+   */
+  inline void _fetch(_fv3_float_t modulation, _fv3_float_t * a, _fv3_float_t * b, _fv3_float_t * frac)
+  {
+    modulation = (modulation + 1.) * modulationsize_f;
+    _fv3_float_t floor_mod = std::floor(modulation); // >= 0
+    *frac = 1. - (modulation - floor_mod); // >= 0
+
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
+
+    *a = buffer[readidx_a]; *b = buffer[readidx_b];
+    readidx = _wraph(readidx + 1);
+  }
+
+  /**
+   * The write half of _process() for vectorized callers.
+   * @param[in] value The value to be written (input + z_1 * feedback).
+   */
+  inline void _store(_fv3_float_t value)
+  {
+    buffer[writeidx] = value;
+    writeidx = _wraph(writeidx + 1);
+  }
+ 
  private:
   _FV3_(allpassm)(const _FV3_(allpassm)& x);
   _FV3_(allpassm)& operator=(const _FV3_(allpassm)& x);
+  // In the power of two mode bufsize is a power of two and all indices are
+  // wrapped with a mask, otherwise with a compare.
+#ifdef ENABLE_POW2_DELAY
+  inline long _wrapl(long idx){ return idx & bufmask; }
+  inline long _wraph(long idx){ return idx & bufmask; }
+#else
+  inline long _wrapl(long idx){ return idx < 0 ? idx + bufsize : idx; }
+  inline long _wraph(long idx){ return idx >= bufsize ? idx - bufsize : idx; }
+#endif
   _fv3_float_t feedback, feedback_mod, *buffer, z_1, decay, modulationsize_f;
-  long bufsize, readidx, writeidx, modulationsize;
+  long bufsize, bufmask, readidx, writeidx, delaysize, modulationsize;
+  bool ownbuffer;
 };
 
 /**
@@ -0,0 +1,70 @@
+/**
+ *  Delay Buffer Arena
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include "freeverb/arena.hpp"
+#include "freeverb/fv3_type_float.h"
+#include "freeverb/fv3_ns_start.h"
+
+FV3_(arena)::FV3_(arena)()
+{
+  block = NULL; size = offset = 0; measuring = false;
+}
+
+FV3_(arena)::FV3_(~arena)()
+{
+  free();
+}
+
+void FV3_(arena)::free()
+{
+  if(block != NULL) FV3_(utils)::aligned_free(block);
+  block = NULL; size = offset = 0;
+}
+
+void FV3_(arena)::measure()
+{
+  measuring = true; offset = 0;
+}
+
+void FV3_(arena)::commit()
+{
+  measuring = false;
+  if(offset > size)
+    {
+      free();
+      block = (fv3_float_t*)FV3_(utils)::aligned_malloc(sizeof(fv3_float_t)*offset, FV3_ARENA_ALIGN_BYTE);
+      if(block == NULL) throw std::bad_alloc();
+      size = offset;
+    }
+  if(block != NULL) FV3_(utils)::mute(block, size);
+  offset = 0;
+}
+
+fv3_float_t * FV3_(arena)::alloc(long nsize)
+{
+  if(nsize <= 0) return NULL;
+  const long align = FV3_ARENA_ALIGN_BYTE/sizeof(fv3_float_t);
+  fv3_float_t * buffer = measuring ? NULL : block + offset;
+  offset += (nsize + align - 1)/align*align;
+  if(offset > size) return NULL;
+  return buffer;
+}
+
+#include "freeverb/fv3_ns_end.h"
@@ -0,0 +1,55 @@
+/**
+ *  Delay Buffer Arena
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * One aligned block of memory for all delay buffers of a reverb instance.
+ * The buffers are laid out in two passes with the same calls: after measure(),
+ * alloc() only adds up the sizes and returns NULL. commit() (re)allocates the
+ * block and clears it, after which alloc() returns the buffers in the same order.
+ */
+class _FV3_(arena)
+{
+ public:
+  _FV3_(arena)();
+  _FV3_(~arena)();
+  void free();
+
+  void measure();
+  void commit();
+  _fv3_float_t * alloc(long nsize);
+  long getsize(){ return size; }
+
+  /**
+   * Move the buffer of a delay line into the arena.
+   * @param[in] line Any delay line with getbufsize() and setbuffer().
+   */
+  template<class T> void place(T & line)
+  {
+    long n = line.getbufsize();
+    if(n > 0) line.setbuffer(alloc(n), n);
+  }
+
+ private:
+  _FV3_(arena)(const _FV3_(arena)& x);
+  _FV3_(arena)& operator=(const _FV3_(arena)& x);
+  _fv3_float_t * block;
+  long size, offset;
+  bool measuring;
+};
@@ -27,7 +27,7 @@
 
 FV3_(comb)::FV3_(comb)()
 {
-  bufsize = bufidx = 0; buffer = NULL; setdamp(0);
+  bufsize = bufidx = delaysize = 0; buffer = NULL; ownbuffer = true; setdamp(0);
   feedback = filterstore = 0;
 }
 
@@ -38,7 +38,7 @@ FV3_(comb)::FV3_(~comb)()
 
 long FV3_(comb)::getsize()
 {
-  return bufsize;
+  return delaysize;
 }
 
 void FV3_(comb)::setsize(long size)
@@ -46,35 +46,58 @@ void FV3_(comb)::setsize(long size)
 #ifdef FVDEBUG
   std::fprintf(stderr, "comb::setsize(%ld)\n", size);
 #endif
-  if(size <= 0) return;
-  fv3_float_t * new_buffer = NULL;
-  new_buffer = new fv3_float_t[size];
-  FV3_(utils)::mute(new_buffer, size);
-  
-  if(bufsize > 0&&bufsize <= size)
-    {
-      long prefix_i = size-bufsize;
-      for(long i = 0;i < bufsize;i++) new_buffer[prefix_i + i] = this->process(0);
-    }
-  if(bufsize > 0&&bufsize > size)
+  if(size <= 0||size == delaysize) return;
+  setmaxsize(size);
+
+  // The delay is the ring of the first delaysize samples of the buffer. The
+  // ring is unrolled in place so that the oldest sample is read first, then
+  // a longer delay gets silence before it and a shorter one drops the
+  // oldest samples.
+  if(delaysize > 0)
     {
-      long cut = bufsize - size;
-      for(long i = 0;i < cut;i ++)  this->process(0);
-      for(long i = 0;i < size;i ++) new_buffer[i] = this->process(0);
+      std::rotate(buffer, buffer + bufidx, buffer + delaysize);
+      if(delaysize <= size)
+        {
+          std::copy_backward(buffer, buffer + delaysize, buffer + size);
+          FV3_(utils)::mute(buffer, size - delaysize);
+        }
+      else
+        std::copy(buffer + delaysize - size, buffer + delaysize, buffer);
     }
+  else
+    FV3_(utils)::mute(buffer, size);
 
-  this->free();
   bufidx = 0;
-  bufsize = size;
-  buffer = new_buffer;
+  delaysize = size;
   filterstore = 0;
 }
 
+void FV3_(comb)::setmaxsize(long size)
+{
+  if(size <= bufsize) return;
+  fv3_float_t * new_buffer = NULL;
+  new_buffer = new fv3_float_t[size];
+  FV3_(utils)::mute(new_buffer, size);
+  if(delaysize > 0) std::copy(buffer, buffer + delaysize, new_buffer);
+
+  if(buffer != NULL&&ownbuffer) delete[] buffer;
+  buffer = new_buffer; ownbuffer = true;
+  bufsize = size;
+}
+
 void FV3_(comb)::free()
 {
   if(buffer == NULL||bufsize == 0) return;
-  delete[] buffer;
-  buffer = NULL; bufidx = bufsize = 0; filterstore = 0;
+  if(ownbuffer) delete[] buffer;
+  buffer = NULL; bufidx = bufsize = delaysize = 0; filterstore = 0; ownbuffer = true;
+}
+
+void FV3_(comb)::setbuffer(fv3_float_t * buf, long size)
+{
+  if(buf == NULL||size < bufsize||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = buf; ownbuffer = false;
+  mute();
 }
 
 void FV3_(comb)::mute()
@@ -30,11 +30,30 @@ public:
   void free();
 
   /**
-   * Set delay size. This preserves previous data.
+   * Set delay size. This preserves previous data and does nothing if the size is unchanged.
+   * The buffer is only reallocated if it is smaller than size.
    * @param[in] size The delay size.
    */
   void setsize(long size);
   long getsize();
+
+  /**
+   * Allocate the buffer for delay sizes up to size, so that later setsize()
+   * calls within this size do not allocate memory.
+   * @param[in] size The maximum delay size.
+   */
+  void setmaxsize(long size);
+
+  /**
+   * Use external memory (see arena) instead of an own buffer. The buffer is
+   * cleared and not freed by this object. Resizing beyond getbufsize()
+   * allocates an own buffer again.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] size The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long size);
+  long getbufsize(){ return bufsize; }
+
   void mute();
   void          setdamp(_fv3_float_t val);
   _fv3_float_t  getdamp();
@@ -50,7 +69,7 @@ public:
    */
   inline _fv3_float_t process(_fv3_float_t input)
   {
-    if(bufsize == 0) return input;
+    if(delaysize == 0) return input;
     return _process(input);
   }
   inline _fv3_float_t operator()(_fv3_float_t input){return process(input);}
@@ -60,7 +79,7 @@ public:
     UNDENORMAL(output);
     filterstore = (output * damp2) + (filterstore * damp1);
     buffer[bufidx] = input + (filterstore * feedback);
-    bufidx ++; if(bufidx >= bufsize) bufidx = 0;
+    bufidx ++; if(bufidx >= delaysize) bufidx = 0;
     return output;
   }
 
@@ -70,7 +89,7 @@ public:
    */
   inline _fv3_float_t process_ff(_fv3_float_t input)
   {
-    if(bufsize == 0) return input;
+    if(delaysize == 0) return input;
     return _process_ff(input);
   }
   inline _fv3_float_t process_ff(_fv3_float_t input, _fv3_float_t fb){ setfeedback(fb); return process_ff(input); }
@@ -78,7 +97,7 @@ public:
   {
     _fv3_float_t output = buffer[bufidx] * feedback + input;
     buffer[bufidx] = input;
-    bufidx ++; if(bufidx >= bufsize) bufidx = 0;
+    bufidx ++; if(bufidx >= delaysize) bufidx = 0;
     UNDENORMAL(output);
     return output;
   }
@@ -90,7 +109,7 @@ public:
    */
   inline _fv3_float_t process_fb(_fv3_float_t input)
   {
-    if(bufsize == 0) return input;
+    if(delaysize == 0) return input;
     return _process_fb(input);
   }
   inline _fv3_float_t process_fb(_fv3_float_t input, _fv3_float_t fb){ setfeedback(fb); return process_fb(input); }
@@ -98,7 +117,7 @@ public:
   {
     input = buffer[bufidx] * feedback + input;
     buffer[bufidx] = input;
-    bufidx ++; if(bufidx >= bufsize) bufidx = 0;
+    bufidx ++; if(bufidx >= delaysize) bufidx = 0;
     UNDENORMAL(input);
     return input;
   }
@@ -108,7 +127,8 @@ private:
   _FV3_(comb)(const _FV3_(comb)& x);
   _FV3_(comb)& operator=(const _FV3_(comb)& x);
   _fv3_float_t *buffer, feedback, filterstore, damp1, damp2;
-  long bufsize, bufidx;
+  long bufsize, bufidx, delaysize;
+  bool ownbuffer;
 };
 
 /**
@@ -26,7 +26,7 @@
 
 FV3_(delay)::FV3_(delay)()
 {
-  feedback = 1.; bufsize = bufidx = 0; buffer = NULL;
+  feedback = 1.; bufsize = bufidx = bufmask = 0; buffer = NULL; ownbuffer = true;
 }
 
 FV3_(delay)::~FV3_(delay)()
@@ -41,7 +41,29 @@ long FV3_(delay)::getsize()
 
 void FV3_(delay)::setsize(long size)
 {
-  if(size <= 0) return;
+  if(size <= 0||size == bufsize) return;
+#ifdef ENABLE_POW2_DELAY
+  // The ring already holds the last bufmask+1 samples, so a size within it
+  // only moves the read position. The samples between the old and the new
+  // size are cleared like in the reallocating version.
+  if(buffer != NULL&&size <= bufmask+1)
+    {
+      for(long i = bufsize+1;i <= size;i ++) buffer[(bufidx-i)&bufmask] = 0;
+      bufsize = size;
+      return;
+    }
+  long newsize = FV3_(utils)::checkPow2(size);
+  fv3_float_t * new_buffer = NULL;
+  new_buffer = new fv3_float_t[newsize];
+  FV3_(utils)::mute(new_buffer, newsize);
+  for(long i = 1;i <= bufsize&&i <= size;i ++) new_buffer[newsize-i] = buffer[(bufidx-i)&bufmask];
+
+  this->free();
+  bufidx = 0;
+  bufsize = size;
+  bufmask = newsize-1;
+  buffer = new_buffer;
+#else
   fv3_float_t * new_buffer = NULL;
   new_buffer = new fv3_float_t[size];
   FV3_(utils)::mute(new_buffer, size);
@@ -62,19 +84,28 @@ void FV3_(delay)::setsize(long size)
   bufidx = 0;
   bufsize = size;
   buffer = new_buffer;
+#endif
 }
 
 void FV3_(delay)::free()
 {
   if(buffer == NULL||bufsize == 0) return;
-  delete[] buffer;
-  buffer = NULL; bufidx = bufsize = 0;
+  if(ownbuffer) delete[] buffer;
+  buffer = NULL; bufidx = bufsize = bufmask = 0; ownbuffer = true;
+}
+
+void FV3_(delay)::setbuffer(fv3_float_t * buf, long size)
+{
+  if(buf == NULL||size < getbufsize()||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = buf; ownbuffer = false;
+  mute();
 }
 
 void FV3_(delay)::mute()
 {
   if(buffer == NULL||bufsize == 0) return;
-  FV3_(utils)::mute(buffer, bufsize);
+  FV3_(utils)::mute(buffer, getbufsize());
   bufidx = 0;
 }
 
@@ -92,25 +123,25 @@ fv3_float_t FV3_(delay)::getfeedback()
 
 FV3_(delaym)::FV3_(delaym)()
 {
-  bufsize = readidx = writeidx = modulationsize = 0;
+  bufsize = bufmask = readidx = writeidx = delaysize = modulationsize = 0;
   feedback = 1.;
   z_1 = modulationsize_f = 0;
-  buffer = NULL;
+  buffer = NULL; ownbuffer = true;
 }
 
 FV3_(delaym)::~FV3_(delaym)()
 {
-  if(bufsize != 0) delete[] buffer;
+  free();
 }
 
 long FV3_(delaym)::getsize()
 {
-  return bufsize;
+  return delaysize + modulationsize;
 }
 
 long FV3_(delaym)::getdelaysize()
 {
-  return (bufsize - modulationsize);
+  return delaysize;
 }
 
 long FV3_(delaym)::getmodulationsize()
@@ -128,36 +159,62 @@ void FV3_(delaym)::setsize(long size, long modsize)
 #ifdef FVDEBUG
   std::fprintf(stderr, "delaym::setsize(%ld,%ld)\n", size, modsize);
 #endif
+  if(size <= 0) return;
+  if(modsize < 0) modsize = 0;
+  if(modsize > size) modsize = size;
+  setmaxsize(size, modsize);
+
+  // The buffer is a ring of bufsize samples and the delay is the distance
+  // between the read and the write position, so a shorter delay than the
+  // buffer only moves the read position and keeps the delayed signal.
+  delaysize = size;
+  modulationsize = modsize;
+  modulationsize_f = (fv3_float_t)modulationsize;
+  readidx = writeidx - (delaysize - modulationsize); if(readidx < 0) readidx += bufsize;
+}
+
+void FV3_(delaym)::setmaxsize(long size, long modsize)
+{
   if(size <= 0) return;
   if(modsize < 0) modsize = 0;
   if(modsize > size) modsize = size;
   long newsize = size + modsize;
+#ifdef ENABLE_POW2_DELAY
+  newsize = FV3_(utils)::checkPow2(newsize);
+#endif
+  if(newsize <= bufsize) return;
   fv3_float_t * new_buffer = NULL;
   new_buffer = new fv3_float_t[newsize];
   FV3_(utils)::mute(new_buffer, newsize);
-  
-  this->free();
-  bufsize = newsize;
-  readidx = modsize*2;
-  writeidx = 0;
-  modulationsize = modsize;
-  modulationsize_f = (fv3_float_t)modulationsize;
-  buffer = new_buffer;
-  z_1 = 0;
+
+  if(buffer != NULL&&ownbuffer) delete[] buffer;
+  buffer = new_buffer; ownbuffer = true;
+  bufsize = newsize; bufmask = newsize-1;
+  writeidx = 0; z_1 = 0;
+  readidx = bufsize - (delaysize - modulationsize); if(readidx >= bufsize) readidx -= bufsize;
 }
 
 void FV3_(delaym)::free()
 {
   if(buffer == NULL||bufsize == 0) return;
-  delete[] buffer;
-  buffer = NULL; writeidx = bufsize = 0; z_1 = 0;
+  if(ownbuffer) delete[] buffer;
+  buffer = NULL; readidx = writeidx = bufsize = bufmask = delaysize = modulationsize = 0; z_1 = 0; ownbuffer = true;
+}
+
+void FV3_(delaym)::setbuffer(fv3_float_t * buf, long size)
+{
+  if(buf == NULL||size < bufsize||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = buf; ownbuffer = false;
+  mute();
 }
 
 void FV3_(delaym)::mute()
 {
   if(buffer == NULL||bufsize == 0) return;
   FV3_(utils)::mute(buffer, bufsize);
-  writeidx = 0; z_1 = 0; readidx = modulationsize*2;
+  writeidx = 0; z_1 = 0;
+  readidx = bufsize - (delaysize - modulationsize); if(readidx >= bufsize) readidx -= bufsize;
 }
 
 void FV3_(delaym)::setfeedback(fv3_float_t val) 
@@ -170,4 +227,95 @@ fv3_float_t FV3_(delaym)::getfeedback()
   return feedback;
 }
 
+// gliding delay
+
+FV3_(delayg)::FV3_(delayg)()
+{
+  buffer = NULL; readpos = glide = 0; bufsize = writeidx = delaysize = 0; ownbuffer = true;
+}
+
+FV3_(delayg)::~FV3_(delayg)()
+{
+  free();
+}
+
+long FV3_(delayg)::getsize()
+{
+  return delaysize;
+}
+
+long FV3_(delayg)::getmaxsize()
+{
+  return bufsize > 2 ? bufsize - 2 : 0;
+}
+
+void FV3_(delayg)::setsize(long size)
+{
+  if(size < 0) size = 0;
+  if(size > getmaxsize())
+    {
+      setmaxsize(size);
+      delaysize = size;
+      settle();
+      return;
+    }
+  if(glide <= 0)
+    {
+      // the old content stays, the read position jumps like in delay
+      delaysize = size;
+      settle();
+      return;
+    }
+  delaysize = size;
+}
+
+void FV3_(delayg)::setmaxsize(long size)
+{
+  if(size <= getmaxsize()||size <= 0) return;
+  long newsize = size + 2;
+  fv3_float_t * new_buffer = new fv3_float_t[newsize];
+  FV3_(utils)::mute(new_buffer, newsize);
+  if(buffer != NULL&&ownbuffer) delete[] buffer;
+  buffer = new_buffer; ownbuffer = true;
+  bufsize = newsize; writeidx = 0;
+}
+
+void FV3_(delayg)::setglide(fv3_float_t speed)
+{
+  glide = speed < 0 ? 0 : speed;
+}
+
+fv3_float_t FV3_(delayg)::getglide()
+{
+  return glide;
+}
+
+void FV3_(delayg)::settle()
+{
+  readpos = (fv3_float_t)delaysize;
+}
+
+void FV3_(delayg)::free()
+{
+  if(buffer == NULL||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = NULL; bufsize = writeidx = delaysize = 0; readpos = 0; ownbuffer = true;
+}
+
+void FV3_(delayg)::setbuffer(fv3_float_t * buf, long size)
+{
+  if(buf == NULL||size < bufsize||bufsize == 0) return;
+  if(ownbuffer) delete[] buffer;
+  buffer = buf; ownbuffer = false;
+  mute();
+}
+
+void FV3_(delayg)::mute()
+{
+  settle();
+  if(buffer == NULL||bufsize == 0) return;
+  FV3_(utils)::mute(buffer, bufsize);
+  writeidx = 0;
+}
+
 #include "freeverb/fv3_ns_end.h"
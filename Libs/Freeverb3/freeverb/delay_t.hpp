@@ -29,12 +29,26 @@ class _FV3_(delay)
   void free();
   
   /**
-   * Set delay size. This preserves previous data.
+   * Set delay size. This preserves previous data and does nothing if the size is unchanged.
    * @param[in] size The delay size.
    */
   void setsize(long size);
   long getsize();
 
+  /**
+   * Use external memory (see arena) instead of an own buffer. The buffer is
+   * cleared and not freed by this object. Resizing beyond getbufsize()
+   * allocates an own buffer again.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] size The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long size);
+#ifdef ENABLE_POW2_DELAY
+  long getbufsize(){ return buffer == NULL ? 0 : bufmask+1; }
+#else
+  long getbufsize(){ return bufsize; }
+#endif
+
   /**
    * Retrive the last signal of the delayline.
    * @return The last signal (z^(-bufsize)) of the delayline. This is the same as get_z(getsize()).
@@ -44,7 +58,7 @@ class _FV3_(delay)
     if(bufsize == 0) return 0;
     return _getlast();
   }
-  inline _fv3_float_t _getlast(){ return buffer[bufidx]; }
+  inline _fv3_float_t _getlast(){ return buffer[_readidx()]; }
   
   /**
    * Retrive the signal of the delayline.
@@ -63,9 +77,7 @@ class _FV3_(delay)
 #ifdef FVDEBUG
     if(index > bufsize||index <= 0) std::fprintf(stderr, "delay::_get_z(%ld,%ld)!\n", index, bufsize);
 #endif
-    long readpoint = bufidx - index;
-    if(readpoint < 0) readpoint += bufsize;
-    return buffer[readpoint];
+    return buffer[_wrapl(bufidx - index)];
   }
 
   inline _fv3_float_t process(_fv3_float_t input)
@@ -76,9 +88,9 @@ class _FV3_(delay)
   inline _fv3_float_t operator()(_fv3_float_t input){ return process(input); }
   inline _fv3_float_t _process(_fv3_float_t input)
   {
-    _fv3_float_t bufout = buffer[bufidx];
+    _fv3_float_t bufout = buffer[_readidx()];
     buffer[bufidx] = input;
-    bufidx ++; if(bufidx >= bufsize) bufidx = 0;
+    bufidx = _wraph(bufidx + 1);
     return bufout;
   }
   
@@ -89,9 +101,9 @@ class _FV3_(delay)
   }
   inline _fv3_float_t _process_wf(_fv3_float_t input)
   {
-    _fv3_float_t bufout = buffer[bufidx];
+    _fv3_float_t bufout = buffer[_readidx()];
     buffer[bufidx] = feedback*input;
-    bufidx ++; if(bufidx >= bufsize) bufidx = 0;
+    bufidx = _wraph(bufidx + 1);
     return bufout;
   }
 
@@ -102,8 +114,23 @@ class _FV3_(delay)
  private:
   _FV3_(delay)(const _FV3_(delay)& x);
   _FV3_(delay)& operator=(const _FV3_(delay)& x);  
+
+  // In the power of two mode the ring has bufmask+1 samples, the delay is
+  // read bufsize samples behind the write position and all indices are
+  // wrapped with a mask. Otherwise the ring has exactly bufsize samples.
+#ifdef ENABLE_POW2_DELAY
+  inline long _readidx(){ return (bufidx - bufsize) & bufmask; }
+  inline long _wrapl(long idx){ return idx & bufmask; }
+  inline long _wraph(long idx){ return idx & bufmask; }
+#else
+  inline long _readidx(){ return bufidx; }
+  inline long _wrapl(long idx){ return idx < 0 ? idx + bufsize : idx; }
+  inline long _wraph(long idx){ return idx >= bufsize ? idx - bufsize : idx; }
+#endif
+
   _fv3_float_t feedback, *buffer;
-  long bufsize, bufidx;
+  long bufsize, bufidx, bufmask;
+  bool ownbuffer;
 };
 
 /**
@@ -116,8 +143,33 @@ class _FV3_(delaym)
   _FV3_(~delaym)();
   void free();
 
+  /**
+   * Set delay size. The buffer is only reallocated (and cleared) if it is
+   * smaller than size+modsize, otherwise only the read position is moved.
+   * @param[in] size The delay size.
+   * @param[in] modsize The modulation size.
+   */
   void setsize(long size);
   void setsize(long size, long modsize);
+
+  /**
+   * Allocate the buffer for delay sizes up to size+modsize, so that later
+   * setsize() calls within this size do not allocate memory.
+   * @param[in] size The maximum delay size.
+   * @param[in] modsize The maximum modulation size.
+   */
+  void setmaxsize(long size, long modsize);
+
+  /**
+   * Use external memory (see arena) instead of an own buffer. The buffer is
+   * cleared and not freed by this object. Resizing beyond getbufsize()
+   * allocates an own buffer again.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] size The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long size);
+  long getbufsize(){ return bufsize; }
+
   long getsize();
   long getdelaysize();
   long getmodulationsize();
@@ -144,23 +196,155 @@ class _FV3_(delaym)
     _fv3_float_t floor_mod = std::floor(modulation); // >= 0
     _fv3_float_t m_frac = 1. - (modulation - floor_mod); // >= 0
     
-    long readidx_a = readidx - (long)floor_mod; if(readidx_a < 0) readidx_a += bufsize;
-    long readidx_b = readidx_a - 1; if(readidx_b < 0) readidx_b += bufsize;
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
     
     z_1 = buffer[readidx_b] + m_frac * (buffer[readidx_a] - z_1);
     UNDENORMAL(z_1);
-    readidx ++; if(readidx >= bufsize) readidx = 0;
+    readidx = _wraph(readidx + 1);
     buffer[writeidx] = feedback*input;
-    writeidx ++; if(writeidx >= bufsize) writeidx = 0;
+    writeidx = _wraph(writeidx + 1);
     return z_1;
   }
   inline _fv3_float_t operator()(_fv3_float_t input, _fv3_float_t modulation){ return process(input,modulation); }
 
   inline _fv3_float_t _getlast(){ return z_1; }
+  inline void _setlast(_fv3_float_t value){ z_1 = value; }
+
+  /**
+   * The read half of _process() for vectorized callers, which keep z_1 themselves.
+   * @param[in] modulation The delayline modulation difference. This must be -1~+1.
+   * @param[out] a The sample at the modulated read position.
+   * @param[out] b The sample before the modulated read position.
+   * @param[out] frac The allpass interpolation coefficient.
+   */
+  inline void _fetch(_fv3_float_t modulation, _fv3_float_t * a, _fv3_float_t * b, _fv3_float_t * frac)
+  {
+    modulation = (modulation + 1.) * modulationsize_f;
+    _fv3_float_t floor_mod = std::floor(modulation); // >= 0
+    *frac = 1. - (modulation - floor_mod); // >= 0
+
+    long readidx_a = _wrapl(readidx - (long)floor_mod);
+    long readidx_b = _wrapl(readidx_a - 1);
+
+    *a = buffer[readidx_a]; *b = buffer[readidx_b];
+    readidx = _wraph(readidx + 1);
+  }
+
+  /**
+   * The write half of _process() for vectorized callers.
+   * @param[in] value The value to be written, feedback is not applied.
+   */
+  inline void _store(_fv3_float_t value)
+  {
+    buffer[writeidx] = value;
+    writeidx = _wraph(writeidx + 1);
+  }
   
  private:
   _FV3_(delaym)(const _FV3_(delaym)& x);
-  _FV3_(delaym)& operator=(const _FV3_(delaym)& x);  
+  _FV3_(delaym)& operator=(const _FV3_(delaym)& x);
+  // In the power of two mode bufsize is a power of two and all indices are
+  // wrapped with a mask, otherwise with a compare.
+#ifdef ENABLE_POW2_DELAY
+  inline long _wrapl(long idx){ return idx & bufmask; }
+  inline long _wraph(long idx){ return idx & bufmask; }
+#else
+  inline long _wrapl(long idx){ return idx < 0 ? idx + bufsize : idx; }
+  inline long _wraph(long idx){ return idx >= bufsize ? idx - bufsize : idx; }
+#endif  
   _fv3_float_t feedback, *buffer, z_1, modulationsize_f;
-  long bufsize, readidx, writeidx, modulationsize;
+  long bufsize, bufmask, readidx, writeidx, delaysize, modulationsize;
+  bool ownbuffer;
+};
+
+/**
+ * A delay with an interpolated read head, which moves to a new delay size at
+ * a limited speed instead of jumping. Within getmaxsize() a size change only
+ * sets the target of the read head, so it neither allocates nor clicks.
+ */
+class _FV3_(delayg)
+{
+ public:
+  _FV3_(delayg)();
+  _FV3_(~delayg)();
+  void free();
+
+  /**
+   * Set the delay size the read head moves to. The buffer is only
+   * reallocated (and cleared) if size is larger than getmaxsize(), then the
+   * read head jumps to it.
+   * @param[in] size The delay size.
+   */
+  void setsize(long size);
+  long getsize();
+
+  /**
+   * Allocate the buffer for delay sizes up to size, so that later setsize()
+   * calls within this size do not allocate memory.
+   * @param[in] size The maximum delay size.
+   */
+  void setmaxsize(long size);
+  long getmaxsize();
+
+  /**
+   * Set the speed of the read head in samples per sample. The pitch of the
+   * delayed signal changes by this factor while it moves. 0 (the default)
+   * makes size changes jump like in delay.
+   * @param[in] speed The speed in samples per sample.
+   */
+  void setglide(_fv3_float_t speed);
+  _fv3_float_t getglide();
+
+  /**
+   * Move the read head to the delay size at once.
+   */
+  void settle();
+
+  /**
+   * Use external memory (see arena) instead of an own buffer. The buffer is
+   * cleared and not freed by this object. The read head is settled.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] size The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long size);
+  long getbufsize(){ return bufsize; }
+  void mute();
+
+  inline _fv3_float_t process(_fv3_float_t input)
+  {
+    if(bufsize == 0) return input;
+    return _process(input);
+  }
+  inline _fv3_float_t operator()(_fv3_float_t input){ return process(input); }
+  inline _fv3_float_t _process(_fv3_float_t input)
+  {
+    buffer[writeidx] = input;
+    // The read head only has a fraction while it moves, at the target the
+    // output is the delayed sample itself like in delay.
+    if(readpos != (_fv3_float_t)delaysize)
+      {
+        _fv3_float_t diff = (_fv3_float_t)delaysize - readpos;
+        readpos = (diff > glide||diff < -glide) ? readpos + (diff > 0 ? glide : -glide) : (_fv3_float_t)delaysize;
+      }
+    long pos = (long)readpos;
+    _fv3_float_t frac = readpos - (_fv3_float_t)pos;
+    long idx_a = _wrapl(writeidx - pos);
+    _fv3_float_t output = buffer[idx_a];
+    if(frac > 0) output += frac * (buffer[_wrapl(idx_a - 1)] - output);
+    writeidx = _wraph(writeidx + 1);
+    return output;
+  }
+
+ private:
+  _FV3_(delayg)(const _FV3_(delayg)& x);
+  _FV3_(delayg)& operator=(const _FV3_(delayg)& x);
+  inline long _wrapl(long idx){ return idx < 0 ? idx + bufsize : idx; }
+  inline long _wraph(long idx){ return idx >= bufsize ? idx - bufsize : idx; }
+
+  // the ring holds the input and the samples up to the largest delay plus
+  // one for the interpolation, so bufsize = maxsize+2
+  _fv3_float_t *buffer, readpos, glide;
+  long bufsize, writeidx, delaysize;
+  bool ownbuffer;
 };
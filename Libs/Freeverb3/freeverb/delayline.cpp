@@ -95,7 +95,7 @@ fv3_float_t FV3_(delayline)::process(fv3_float_t input)
 long FV3_(delayline)::p_(fv3_float_t ms)
 {
   long base = static_cast<long>(currentfs*ms*0.001);
-  if(primeMode){while(!FV3_(utils)::isPrime(base)) base++;}
+  if(primeMode) base = FV3_(utils)::nextPrime(base);
   return base;
 }
 
@@ -52,10 +52,21 @@ const fv3_float_t FV3_(earlyref)::preset2_gainL[] =
 const fv3_float_t FV3_(earlyref)::preset2_gainDiff[] =
 { 0.01, -0.01,  0.14, -0.01, };
 
+// out[i] += gain*in[i], the same as the per sample tap sum
+static inline void addtap(fv3_float_t * out, const fv3_float_t * in, fv3_float_t gain, long numsamples)
+{
+  const vec4<fv3_float_t> gain4(gain);
+  long i = 0;
+  for(;i+4 <= numsamples;i += 4) (vec4<fv3_float_t>::load(out+i) + gain4 * vec4<fv3_float_t>::load(in+i)).store(out+i);
+  for(;i < numsamples;i ++) out[i] += gain*in[i];
+}
+
 FV3_(earlyref)::FV3_(earlyref)()
 {
-  tapLength = 0;
-  gainTableL = gainTableR = delayTableL = delayTableR = NULL;
+  tapLength = tapLineSize = tapLineIdx = 0;
+  tapSum.alloc(FV3_EARLYREF_BLOCK_SIZE, 2);
+  gainTableL = gainTableR = timeTableL = timeTableR = NULL;
+  delayTableL = delayTableR = NULL;
   setdryr(0.8); setwetr(0.5); setwidth(0.2);
   setLRDelay(0.3);
   setLRCrossApFreq(750, 4);
@@ -74,7 +85,8 @@ FV3_(earlyref)::FV3_(~earlyref)()
 void FV3_(earlyref)::mute()
 {
   FV3_(revbase)::mute();
-  delayLineL.mute(); delayLineR.mute(); delayLtoR.mute(); delayRtoL.mute();
+  tapLine.mute(); tapSum.mute(); tapLineIdx = 0;
+  delayLtoR.mute(); delayRtoL.mute();
   allpassXL.mute(); allpassXR.mute(); allpassL2.mute(); allpassR2.mute();
 }
 
@@ -116,19 +128,18 @@ void FV3_(earlyref)::loadReflection(const fv3_float_t * delayL, const fv3_float_
 {
   unloadReflection();
   gainTableL = new fv3_float_t[size]; gainTableR = new fv3_float_t[size];
-  delayTableL = new fv3_float_t[size]; delayTableR = new fv3_float_t[size];
+  timeTableL = new fv3_float_t[size]; timeTableR = new fv3_float_t[size];
+  delayTableL = new long[size]; delayTableR = new long[size];
   tapLength = size;
   for(long i = 0;i < size;i ++)
     {
       gainTableL[i] = gainL[i];
       gainTableR[i] = gainL[i]+gainDiff[i];
-      delayTableL[i] = getTotalFactorFs()*delayL[i];
-      delayTableR[i] = getTotalFactorFs()*(delayL[i]+delayDiff[i]);
+      timeTableL[i] = delayL[i];
+      timeTableR[i] = delayL[i]+delayDiff[i];
     }
-  long maxLengthL = (long)(delayTableL[tapLength-1])+10;
-  long maxLengthR = (long)(delayTableR[tapLength-1])+10;
-  delayLineL.setsize(maxLengthL);
-  delayLineR.setsize(maxLengthR);
+  setTapDelays();
+  allocbuffers();
   mute();
 }
 
@@ -136,31 +147,107 @@ void FV3_(earlyref)::unloadReflection()
 {
   if(tapLength == 0) return;
   delete[] gainTableL; delete[] gainTableR;
+  delete[] timeTableL; delete[] timeTableR;
   delete[] delayTableL; delete[] delayTableR;
   tapLength = 0;
 }
 
+fv3_float_t FV3_(earlyref)::getLongestReflection()
+{
+  fv3_float_t longest = 0;
+  for(long i = 0;i < tapLength;i ++)
+    {
+      if(timeTableL[i] > longest) longest = timeTableL[i];
+      if(timeTableR[i] > longest) longest = timeTableR[i];
+    }
+  return longest;
+}
+
+void FV3_(earlyref)::setTapDelays()
+{
+  // the input history is only reallocated if the maximum room size or the sample rate grows
+  long maxDelay = 0;
+  for(long i = 0;i < tapLength;i ++)
+    {
+      delayTableL[i] = (long)(getTotalFactorFs()*timeTableL[i]);
+      delayTableR[i] = (long)(getTotalFactorFs()*timeTableR[i]);
+      if(delayTableL[i] < 0) delayTableL[i] = 0;
+      if(delayTableR[i] < 0) delayTableR[i] = 0;
+      if(delayTableL[i] > maxDelay) maxDelay = delayTableL[i];
+      if(delayTableR[i] > maxDelay) maxDelay = delayTableR[i];
+      long maxL = (long)(getMaxTotalFactorFs()*timeTableL[i]), maxR = (long)(getMaxTotalFactorFs()*timeTableR[i]);
+      if(maxL > maxDelay) maxDelay = maxL;
+      if(maxR > maxDelay) maxDelay = maxR;
+    }
+  if(tapLength == 0||maxDelay+FV3_EARLYREF_BLOCK_SIZE <= tapLineSize) return;
+  tapLineSize = maxDelay+FV3_EARLYREF_BLOCK_SIZE;
+  tapLine.alloc(tapLineSize, 2);
+  tapLineIdx = 0;
+}
+
 void FV3_(earlyref)::processreplace(fv3_float_t *inputL, fv3_float_t *inputR, fv3_float_t *outputL, fv3_float_t *outputR, long numsamples)
 {
   if(numsamples <= 0) return;
+  if(monoInput) inputR = inputL;
+
+  while(numsamples > 0)
+    {
+      long blocksize = numsamples < FV3_EARLYREF_BLOCK_SIZE ? numsamples : FV3_EARLYREF_BLOCK_SIZE;
+      processtaps(inputL, inputR, blocksize);
+      for(long i = 0;i < blocksize;i ++)
+        {
+          *outputL = delayL(*inputL)*dry;
+          *outputR = delayR(*inputR)*dry;
+          // width = -1 ~ +1
+          fv3_float_t wetL = delayWL(tapSum.L[i]), wetR = delayWR(tapSum.R[i]);
+          *outputL += out1_lpf(out1_hpf(allpassL2(wet1 * wetL + wet2 * allpassXL(delayRtoL(*inputR + wetR)))));
+          *outputR += out2_lpf(out2_hpf(allpassR2(wet1 * wetR + wet2 * allpassXR(delayLtoR(*inputL + wetL)))));
+          inputL ++; inputR ++; outputL ++; outputR ++;
+        }
+      numsamples -= blocksize;
+    }
+}
+
+void FV3_(earlyref)::processtaps(const fv3_float_t *inputL, const fv3_float_t *inputR, long numsamples)
+{
+  FV3_(utils)::mute(tapSum.L, numsamples);
+  FV3_(utils)::mute(tapSum.R, numsamples);
+  if(tapLength == 0) return;
+
+  // append the block to the input history, both channels share the left history in the mono input mode
+  long first = tapLineSize - tapLineIdx;
+  if(first > numsamples) first = numsamples;
+  std::memcpy(tapLine.L+tapLineIdx, inputL, sizeof(fv3_float_t)*first);
+  std::memcpy(tapLine.L, inputL+first, sizeof(fv3_float_t)*(numsamples-first));
+  if(!monoInput)
+    {
+      std::memcpy(tapLine.R+tapLineIdx, inputR, sizeof(fv3_float_t)*first);
+      std::memcpy(tapLine.R, inputR+first, sizeof(fv3_float_t)*(numsamples-first));
+    }
+  const fv3_float_t * historyR = monoInput ? tapLine.L : tapLine.R;
 
-  while(numsamples-- > 0)
+  // sum the taps in the same order as the per sample version
+  for(long i = 0;i < tapLength;i ++)
     {
-      *outputL = delayL(*inputL)*dry;
-      *outputR = delayR(*inputR)*dry;
-      fv3_float_t wetL = 0, wetR = 0;
-      delayLineL.process(*inputL); delayLineR.process(*inputR);
-      for(long i = 0;i < tapLength;i ++)
-	{
-	  wetL += gainTableL[i]*delayLineL.at(delayTableL[i]);
-	  wetR += gainTableR[i]*delayLineR.at(delayTableR[i]);
-	}
-      // width = -1 ~ +1
-      wetL = delayWL(wetL); wetR = delayWR(wetR);
-      *outputL += out1_lpf(out1_hpf(allpassL2(wet1 * wetL + wet2 * allpassXL(delayRtoL(*inputR + wetR)))));
-      *outputR += out2_lpf(out2_hpf(allpassR2(wet1 * wetR + wet2 * allpassXR(delayLtoR(*inputL + wetL)))));
-      inputL ++; inputR ++; outputL ++; outputR ++;
+      long startL = tapLineIdx - delayTableL[i]; if(startL < 0) startL += tapLineSize;
+      long firstL = tapLineSize - startL; if(firstL > numsamples) firstL = numsamples;
+      addtap(tapSum.L, tapLine.L+startL, gainTableL[i], firstL);
+      addtap(tapSum.L+firstL, tapLine.L, gainTableL[i], numsamples-firstL);
+
+      long startR = tapLineIdx - delayTableR[i]; if(startR < 0) startR += tapLineSize;
+      long firstR = tapLineSize - startR; if(firstR > numsamples) firstR = numsamples;
+      addtap(tapSum.R, historyR+startR, gainTableR[i], firstR);
+      addtap(tapSum.R+firstR, historyR, gainTableR[i], numsamples-firstR);
     }
+
+  tapLineIdx += numsamples; if(tapLineIdx >= tapLineSize) tapLineIdx -= tapLineSize;
+}
+
+void FV3_(earlyref)::setMonoInput(bool value)
+{
+  // the right history continues from the shared one, which holds the same signal
+  if(monoInput&&!value&&tapLineSize > 0) std::memcpy(tapLine.R, tapLine.L, sizeof(fv3_float_t)*tapLineSize);
+  FV3_(revbase)::setMonoInput(value);
 }
 
 void FV3_(earlyref)::setLRDelay(fv3_float_t value_ms)
@@ -233,7 +320,14 @@ void FV3_(earlyref)::setFsFactors()
   setLRDelay(0.3);
   setLRCrossApFreq(lrCrossApFq, lrCrossApBw);
   setDiffusionApFreq(diffApFq, diffApBw);
-  loadPresetReflection(currentPreset);
+  setTapDelays();
+}
+
+void FV3_(earlyref)::setbuffers()
+{
+  arena.place(tapLine); arena.place(tapSum);
+  FV3_(revbase)::setbuffers();
+  arena.place(delayRtoL); arena.place(delayLtoR);
 }
 
 #include "freeverb/fv3_ns_end.h"
@@ -22,12 +22,17 @@
 #define _FV3_EARLYREF_HPP
 
 #include <cstdio>
+#include <cstring>
 #include <new>
 
 #include "freeverb/fv3_defs.h"
 #include "freeverb/revbase.hpp"
-#include "freeverb/delayline.hpp"
+#include "freeverb/slot.hpp"
 #include "freeverb/biquad.hpp"
+#include "freeverb/vec4.hpp"
+
+// the taps are summed in blocks of this size
+#define FV3_EARLYREF_BLOCK_SIZE 256
 
 namespace fv3
 {
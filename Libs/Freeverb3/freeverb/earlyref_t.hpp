@@ -32,6 +32,10 @@ public:
   void loadUserReflection(const _fv3_float_t * delayL, const _fv3_float_t * gainL,
 			  const _fv3_float_t * delayDiff, const _fv3_float_t * gainDiff, long size);
   void unloadReflection();
+  /**
+   * @return the time of the last reflection in seconds at the room size factor 1.
+   */
+  _fv3_float_t getLongestReflection();
   
   void         setLRDelay(_fv3_float_t value_ms);
   _fv3_float_t getLRDelay();
@@ -44,20 +48,35 @@ public:
   _fv3_float_t getoutputlpf();
   void setoutputhpf(_fv3_float_t value);
   _fv3_float_t getoutputhpf();
+
+  /**
+   * In the mono input mode only the left input history is kept and the
+   * right taps are read from it.
+   */
+  virtual void setMonoInput(bool value);
   
  protected:
   _FV3_(earlyref)(const _FV3_(earlyref)& x);
   _FV3_(earlyref)& operator=(const _FV3_(earlyref)& x);
   void loadReflection(const _fv3_float_t * delayL, const _fv3_float_t * gainL, const _fv3_float_t * delayDiff, const _fv3_float_t * gainDiff, long size);
   virtual void setFsFactors();
-  
-  _FV3_(delayline) delayLineL, delayLineR;
+  virtual void setbuffers();
+  void setTapDelays();
+  void processtaps(const _fv3_float_t *inputL, const _fv3_float_t *inputR, long numsamples);
+
+  // The input history is a ring buffer of the longest tap delay (at the
+  // maximum room size) plus one block. Each tap adds one or two contiguous
+  // spans of it to the tap sum (tapSum). tapLine.R is not written in the
+  // mono input mode.
+  _FV3_(slot) tapLine, tapSum;
+  long tapLineSize, tapLineIdx;
   _FV3_(delay) delayLtoR, delayRtoL;
   _FV3_(biquad) allpassXL, allpassL2, allpassXR, allpassR2;
   _FV3_(iir_1st) out1_lpf, out2_lpf, out1_hpf, out2_hpf;
   long currentPreset, tapLength, lrDelay;
   _fv3_float_t lrCrossApFq, lrCrossApBw, diffApFq, diffApBw, outputlpf, outputhpf;
-  _fv3_float_t *gainTableL, *gainTableR, *delayTableL, *delayTableR;
+  _fv3_float_t *gainTableL, *gainTableR, *timeTableL, *timeTableR;
+  long *delayTableL, *delayTableR;
 
   const static long preset0_size;
   const static _fv3_float_t preset0_delayL[], preset0_delayDiff[], preset0_gainL[], preset0_gainDiff[];
@@ -25,7 +25,7 @@
 FV3_(revbase)::FV3_(revbase)()
 {
   setwetr(1); setdryr(1); setwidth(1);
-  primeMode = true; muteOnChange = false; rsfactor = 1.; currentfs = FV3_REVBASE_DEFAULT_FS;
+  primeMode = true; muteOnChange = false; monoInput = false; rsfactor = maxrsfactor = 1.; maxPreDelay = 0; currentfs = FV3_REVBASE_DEFAULT_FS;
   setPreDelay(0); setReverbType(FV3_REVTYPE_SELF);
 }
 
@@ -78,7 +78,9 @@ long FV3_(revbase)::getInitialDelay()
 
 void FV3_(revbase)::setPreDelay(fv3_float_t value_ms)
 {
-  setInitialDelay((long)(currentfs*(preDelay = value_ms)/1000.));
+  // keep the time instead of the rounded delay, so that it isn't rounded again on every sample rate change
+  setInitialDelay((long)(currentfs*value_ms/1000.));
+  preDelay = value_ms;
 }
 
 fv3_float_t FV3_(revbase)::getPreDelay()
@@ -86,6 +88,36 @@ fv3_float_t FV3_(revbase)::getPreDelay()
   return preDelay;
 }
 
+void FV3_(revbase)::setMaxPreDelay(fv3_float_t value_ms)
+{
+  if(value_ms < 0) return;
+  maxPreDelay = value_ms;
+  setFsFactors();
+  allocbuffers();
+}
+
+fv3_float_t FV3_(revbase)::getMaxPreDelay()
+{
+  return maxPreDelay;
+}
+
+void FV3_(revbase)::setPreDelayGlide(fv3_float_t speed)
+{
+  delayWL.setglide(speed);
+  delayWR.setglide(speed);
+}
+
+fv3_float_t FV3_(revbase)::getPreDelayGlide()
+{
+  return delayWL.getglide();
+}
+
+void FV3_(revbase)::settlePreDelay()
+{
+  delayWL.settle();
+  delayWR.settle();
+}
+
 long FV3_(revbase)::getLatency()
 {
   return 0;
@@ -192,6 +224,7 @@ void FV3_(revbase)::setSampleRate(fv3_float_t fs)
   if(fs <= 0) return;
   currentfs = fs;
   setFsFactors();
+  allocbuffers();
   if(muteOnChange) mute();
 }
 
@@ -208,14 +241,43 @@ fv3_float_t FV3_(revbase)::getRSFactor()
   return rsfactor;
 }
 
+void FV3_(revbase)::setMaxRSFactor(fv3_float_t value)
+{
+  if(value <= 0) return;
+  maxrsfactor = value;
+  setFsFactors();
+  allocbuffers();
+}
+
+fv3_float_t FV3_(revbase)::getMaxRSFactor()
+{
+  return maxrsfactor;
+}
+
 void FV3_(revbase)::setFsFactors()
 {
 #ifdef FVDEBUG
   std::fprintf(stderr, "revbase::setFsFactors(%f,%f)\n", getSampleRate(), getRSFactor());
 #endif
+  delayWL.setmaxsize((long)(currentfs*maxPreDelay/1000.));
+  delayWR.setmaxsize((long)(currentfs*maxPreDelay/1000.));
   setPreDelay(getPreDelay());
 }
 
+void FV3_(revbase)::allocbuffers()
+{
+  arena.measure();
+  setbuffers();
+  arena.commit();
+  setbuffers();
+}
+
+void FV3_(revbase)::setbuffers()
+{
+  arena.place(delayL); arena.place(delayR);
+  arena.place(delayWL); arena.place(delayWR);
+}
+
 void FV3_(revbase)::setPrimeMode(bool value)
 {
   primeMode = value;
@@ -236,6 +298,16 @@ bool FV3_(revbase)::getMuteOnChange()
   return muteOnChange;
 }
 
+void FV3_(revbase)::setMonoInput(bool value)
+{
+  monoInput = value;
+}
+
+bool FV3_(revbase)::getMonoInput()
+{
+  return monoInput;
+}
+
 fv3_float_t FV3_(revbase)::limFs2(fv3_float_t fq)
 {
   if(fq < 0) fq = 0;
@@ -254,7 +326,7 @@ long FV3_(revbase)::p_(long def, fv3_float_t factor){ return p_((fv3_float_t)def
 long FV3_(revbase)::p_(fv3_float_t def, fv3_float_t factor)
 {
   long base = f_(def,factor);
-  if(primeMode){ while(!FV3_(utils)::isPrime(base)) base++; }
+  if(primeMode) base = FV3_(utils)::nextPrime(base);
   return base;
 }
 
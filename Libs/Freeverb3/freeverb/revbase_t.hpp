@@ -35,6 +35,17 @@ public:
   virtual _fv3_float_t getRSFactor();
   virtual _fv3_float_t getTotalFactorFs(){ return getSampleRate()*getRSFactor(); }
 
+  /**
+   * Set the largest room size factor which is used while processing.
+   * The delay buffers are allocated for this factor when the sample rate
+   * is set, so that setRSFactor() up to this value does not allocate memory.
+   * Larger room size factors still work, but reallocate the buffers.
+   * @param[in] value The maximum room size factor.
+   */
+  virtual void setMaxRSFactor(_fv3_float_t value);
+  virtual _fv3_float_t getMaxRSFactor();
+  virtual _fv3_float_t getMaxTotalFactorFs(){ return getSampleRate()*getMaxRSFactor(); }
+
   virtual void setFsFactors();
 
   /**
@@ -53,6 +64,30 @@ public:
   virtual long getInitialDelay();
   virtual void         setPreDelay(_fv3_float_t value_ms);
   virtual _fv3_float_t getPreDelay();
+
+  /**
+   * Set the largest predelay which is used while processing. The wet delay
+   * lines are allocated for it when the sample rate is set, so that
+   * setPreDelay() up to this value only moves their read heads. Longer
+   * predelays still work, but reallocate the buffers.
+   * @param[in] value_ms The maximum predelay in ms.
+   */
+  virtual void         setMaxPreDelay(_fv3_float_t value_ms);
+  virtual _fv3_float_t getMaxPreDelay();
+
+  /**
+   * Set the speed at which the read heads of the wet delay lines move to a
+   * new predelay in samples per sample, the wet signal is interpolated while
+   * they move. 0 (the default) changes the predelay at once.
+   * @param[in] speed The speed in samples per sample.
+   */
+  virtual void         setPreDelayGlide(_fv3_float_t speed);
+  virtual _fv3_float_t getPreDelayGlide();
+
+  /**
+   * Move the read heads of the wet delay lines to the predelay at once.
+   */
+  virtual void settlePreDelay();
   virtual long getLatency();
   virtual void mute();
   virtual void processreplace(_fv3_float_t *inputL, _fv3_float_t *inputR, _fv3_float_t *outputL, _fv3_float_t *outputR, long numsamples) = 0;
@@ -108,12 +143,35 @@ public:
   virtual void setMuteOnChange(bool value);
   virtual bool getMuteOnChange();
 
+  /**
+   * To share the input side processing of both channels for a mono source, turn this option to true. (default=false)
+   * The right input of processreplace() is ignored and the left input is used for both channels.
+   * Implementations may skip or share the right channel's input filters and delay lines, so the output differs from
+   * the stereo mode with the same signal on both inputs. Don't change this while processing.
+   * @param[in] value set true to enable the mono input mode.
+   */
+  virtual void setMonoInput(bool value);
+  virtual bool getMonoInput();
+
   virtual void printconfig();
 
  protected:
+  /**
+   * Move all delay buffers into the arena. This is done when the sample rate
+   * or the maximum room size changes and clears the buffers.
+   */
+  void allocbuffers();
+  /**
+   * Place each delay line in the arena in processing order.
+   * Derived classes add their own delay lines.
+   */
+  virtual void setbuffers();
+  _FV3_(arena) arena;
+
   long initialDelay;
-  _FV3_(delay) delayL, delayR, delayWL, delayWR;
-  _fv3_float_t currentfs, rsfactor, preDelay, wetDB, wet, wet1, wet2, dryDB, dry, width;
+  _FV3_(delay) delayL, delayR;
+  _FV3_(delayg) delayWL, delayWR;
+  _fv3_float_t currentfs, rsfactor, maxrsfactor, preDelay, maxPreDelay, wetDB, wet, wet1, wet2, dryDB, dry, width;
   virtual void update_wet();
   virtual _fv3_float_t limFs2(_fv3_float_t fq);
   
@@ -121,7 +179,7 @@ public:
   virtual long f_(_fv3_float_t def, _fv3_float_t factor);
   virtual long p_(long def, _fv3_float_t factor);
   virtual long p_(_fv3_float_t def, _fv3_float_t factor);
-  bool primeMode, muteOnChange;
+  bool primeMode, muteOnChange, monoInput;
   unsigned reverbType;
 
  private:
@@ -25,7 +25,7 @@
 FV3_(slot)::FV3_(slot)()
 {
   size = ch = 0;
-  data = NULL; L = R = NULL;
+  data = NULL; L = R = NULL; ownbuffer = true;
 }
 
 FV3_(slot)::~FV3_(slot)()
@@ -58,11 +58,24 @@ void FV3_(slot)::free()
 {
   if(size > 0&&ch > 0&&data != NULL)
     {
-      for(long t = 0;t < ch;t ++) FV3_(utils)::aligned_free(data[t]);
+      if(ownbuffer) for(long t = 0;t < ch;t ++) FV3_(utils)::aligned_free(data[t]);
       delete[] data;
     }
   size = ch = 0;
-  data = NULL; L = R = NULL;
+  data = NULL; L = R = NULL; ownbuffer = true;
+}
+
+void FV3_(slot)::setbuffer(fv3_float_t * buf, long nsize)
+{
+  if(buf == NULL||nsize < size*ch||size == 0||ch == 0||data == NULL) return;
+  for(long t = 0;t < ch;t ++)
+    {
+      if(ownbuffer) FV3_(utils)::aligned_free(data[t]);
+      data[t] = buf + t*size;
+    }
+  ownbuffer = false;
+  L = this->c(0); R = this->c(1);
+  mute();
 }
 
 fv3_float_t ** FV3_(slot)::getArray()
@@ -31,6 +31,15 @@ class _FV3_(slot)
   void mute(long offset, long limit);
   long getsize(){ return size; }
   long getch(){ return ch; }
+
+  /**
+   * Use external memory (see arena) for the channels, which are placed one
+   * after another. The memory is cleared and not freed by this object.
+   * @param[in] buf The new buffer. NULL is ignored.
+   * @param[in] nsize The size of buf, at least getbufsize().
+   */
+  void setbuffer(_fv3_float_t * buf, long nsize);
+  long getbufsize(){ return size*ch; }
   _fv3_float_t ** getArray();
   _fv3_float_t *L, *R;
 
@@ -39,4 +48,5 @@ class _FV3_(slot)
   _FV3_(slot)& operator=(const _FV3_(slot)& x);
   long size, ch;
   _fv3_float_t ** data;
+  bool ownbuffer;
 };
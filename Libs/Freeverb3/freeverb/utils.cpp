@@ -54,11 +54,49 @@ long FV3_(utils)::checkPow2(long i)
   return p;
 }
 
+namespace
+{
+  /**
+   * Sieve of Eratosthenes of the odd numbers below FV3_UTILS_PRIME_TABLE_SIZE,
+   * bit i is set if 2*i+1 is a prime. 1 is a prime here like in the trial
+   * division of isPrime(). The table is built once on first use (64kB).
+   */
+  class primetable
+  {
+  public:
+    primetable()
+    {
+      std::memset(bits, 0xff, sizeof(bits));
+      for(long i = 3;i*i < FV3_UTILS_PRIME_TABLE_SIZE;i += 2)
+	if(isset(i)) for(long j = i*i;j < FV3_UTILS_PRIME_TABLE_SIZE;j += 2*i) bits[j>>6] &= ~(UINT32_C(1) << ((j>>1)&31));
+    }
+    bool isset(long odd) const { return (bits[odd>>6] >> ((odd>>1)&31))&1; }
+    long next(long odd) const
+    {
+      // skip the words without primes, the gaps are much shorter than 64
+      long i = odd>>1;
+      uint32_t word = bits[i>>5] >> (i&31);
+      while(word == 0)
+	{
+	  i = ((i>>5)+1)<<5;
+	  if(i >= FV3_UTILS_PRIME_TABLE_SIZE/2) return -1;
+	  word = bits[i>>5];
+	}
+      while((word&1) == 0){ word >>= 1; i ++; }
+      return 2*i+1;
+    }
+    static const primetable & get(){ static const primetable table; return table; }
+  private:
+    uint32_t bits[FV3_UTILS_PRIME_TABLE_SIZE/64];
+  };
+}
+
 bool FV3_(utils)::isPrime(long number)
 {
   if(number == 2) return true;
   if(number & 1)
     {
+      if(number > 0&&number < FV3_UTILS_PRIME_TABLE_SIZE) return primetable::get().isset(number);
       for (long i=3; i<(long)std::sqrt((double)number)+1; i+=2)
 	if ( (number % i) == 0) return false;
       return true; // prime
@@ -67,6 +105,21 @@ bool FV3_(utils)::isPrime(long number)
     return false; // even
 }
 
+long FV3_(utils)::nextPrime(long number)
+{
+  if(number <= 1) return 1;
+  if(number == 2) return 2;
+  if((number & 1) == 0) number ++;
+  if(number < FV3_UTILS_PRIME_TABLE_SIZE)
+    {
+      long prime = primetable::get().next(number);
+      if(prime > 0) return prime;
+      number = FV3_UTILS_PRIME_TABLE_SIZE+1;
+    }
+  while(!isPrime(number)) number += 2;
+  return number;
+}
+
 void * FV3_(utils)::aligned_malloc(size_t size, size_t align_size)
 {
   // [...padding {1~align_size byte(s)}...|<void*>|...aligned data...]
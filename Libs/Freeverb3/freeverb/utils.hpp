@@ -29,6 +29,12 @@
 #include <stdint.h>
 #include "freeverb/fv3_defs.h"
 
+/**
+ * isPrime() and nextPrime() look up the numbers below this in a sieve, which
+ * covers the delay lengths of the largest room sizes at 768kHz.
+ */
+#define FV3_UTILS_PRIME_TABLE_SIZE (1L<<20)
+
 namespace fv3
 {
 
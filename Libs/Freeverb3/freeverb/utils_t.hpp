@@ -28,6 +28,10 @@ class _FV3_(utils)
   static void mute(_fv3_float_t * f, long t);
   static long checkPow2(long i);
   static bool isPrime(long number);
+  /**
+   * The smallest number >= number for which isPrime() is true.
+   */
+  static long nextPrime(long number);
   static void * aligned_malloc(size_t size, size_t align_size);
   static void   aligned_free(void *ptr);
   static uint16_t getX87CW();
@@ -0,0 +1,172 @@
+/**
+ *  4 lane vector type for the FDN kernels
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#ifndef _FV3_VEC4_HPP
+#define _FV3_VEC4_HPP
+
+#include <cfloat>
+#include "freeverb/fv3_defs.h"
+
+#if defined(ENABLE_X86SIMD)&&(defined(__SSE2__)||defined(_M_X64)||(defined(_M_IX86_FP)&&_M_IX86_FP >= 2))
+#define FV3_VEC4_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)||defined(__ARM_NEON__)
+#define FV3_VEC4_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace fv3
+{
+  /**
+   * A vector of 4 lanes. All operations are done lane by lane in the same
+   * order as the scalar code, so a vectorized kernel produces the same
+   * results as the scalar version. The generic version is used for double
+   * and long double and on targets without SSE2 or NEON.
+   */
+  template<typename T>
+  struct vec4
+  {
+    T v[4];
+
+    vec4(){ v[0] = v[1] = v[2] = v[3] = 0; }
+    explicit vec4(T x){ v[0] = v[1] = v[2] = v[3] = x; }
+    vec4(T x0, T x1, T x2, T x3){ v[0] = x0; v[1] = x1; v[2] = x2; v[3] = x3; }
+
+    static inline vec4 load(const T * p){ return vec4(p[0], p[1], p[2], p[3]); }
+    inline void store(T * p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+
+    inline vec4 operator+(const vec4& x) const { return vec4(v[0]+x.v[0], v[1]+x.v[1], v[2]+x.v[2], v[3]+x.v[3]); }
+    inline vec4 operator-(const vec4& x) const { return vec4(v[0]-x.v[0], v[1]-x.v[1], v[2]-x.v[2], v[3]-x.v[3]); }
+    inline vec4 operator*(const vec4& x) const { return vec4(v[0]*x.v[0], v[1]*x.v[1], v[2]*x.v[2], v[3]*x.v[3]); }
+
+    /** @return {x1, x0, x3, x2} */
+    inline vec4 swappairs() const { return vec4(v[1], v[0], v[3], v[2]); }
+    /** @return {x2, x3, x0, x1} */
+    inline vec4 swaphalves() const { return vec4(v[2], v[3], v[0], v[1]); }
+
+    /** The vector version of UNDENORMAL(). */
+    inline vec4 undenormal() const
+    {
+      vec4 r = *this;
+      UNDENORMAL(r.v[0]); UNDENORMAL(r.v[1]); UNDENORMAL(r.v[2]); UNDENORMAL(r.v[3]);
+      return r;
+    }
+  };
+
+#if defined(FV3_VEC4_SSE)
+  template<>
+  struct vec4<float>
+  {
+    __m128 v;
+
+    vec4() : v(_mm_setzero_ps()){}
+    explicit vec4(float x) : v(_mm_set1_ps(x)){}
+    vec4(float x0, float x1, float x2, float x3) : v(_mm_setr_ps(x0, x1, x2, x3)){}
+    vec4(__m128 x) : v(x){}
+
+    static inline vec4 load(const float * p){ return vec4(_mm_loadu_ps(p)); }
+    inline void store(float * p) const { _mm_storeu_ps(p, v); }
+
+    inline vec4 operator+(const vec4& x) const { return vec4(_mm_add_ps(v, x.v)); }
+    inline vec4 operator-(const vec4& x) const { return vec4(_mm_sub_ps(v, x.v)); }
+    inline vec4 operator*(const vec4& x) const { return vec4(_mm_mul_ps(v, x.v)); }
+
+    inline vec4 swappairs() const { return vec4(_mm_shuffle_ps(v, v, _MM_SHUFFLE(2,3,0,1))); }
+    inline vec4 swaphalves() const { return vec4(_mm_shuffle_ps(v, v, _MM_SHUFFLE(1,0,3,2))); }
+
+    inline vec4 undenormal() const
+    {
+#ifdef DISABLE_UNDENORMAL
+      return *this;
+#else
+      // keep normal numbers, flush denormals, inf and nan (like fpclassify() in UNDENORMAL())
+      __m128 a = _mm_andnot_ps(_mm_set1_ps(-0.f), v);
+      __m128 normal = _mm_and_ps(_mm_cmpge_ps(a, _mm_set1_ps(FLT_MIN)), _mm_cmple_ps(a, _mm_set1_ps(FLT_MAX)));
+      return vec4(_mm_and_ps(v, normal));
+#endif
+    }
+  };
+#elif defined(FV3_VEC4_NEON)
+  template<>
+  struct vec4<float>
+  {
+    float32x4_t v;
+
+    vec4() : v(vdupq_n_f32(0)){}
+    explicit vec4(float x) : v(vdupq_n_f32(x)){}
+    vec4(float x0, float x1, float x2, float x3){ float p[4] = {x0, x1, x2, x3,}; v = vld1q_f32(p); }
+    vec4(float32x4_t x) : v(x){}
+
+    static inline vec4 load(const float * p){ return vec4(vld1q_f32(p)); }
+    inline void store(float * p) const { vst1q_f32(p, v); }
+
+    inline vec4 operator+(const vec4& x) const { return vec4(vaddq_f32(v, x.v)); }
+    inline vec4 operator-(const vec4& x) const { return vec4(vsubq_f32(v, x.v)); }
+    inline vec4 operator*(const vec4& x) const { return vec4(vmulq_f32(v, x.v)); }
+
+    inline vec4 swappairs() const { return vec4(vrev64q_f32(v)); }
+    inline vec4 swaphalves() const { return vec4(vextq_f32(v, v, 2)); }
+
+    inline vec4 undenormal() const
+    {
+#ifdef DISABLE_UNDENORMAL
+      return *this;
+#else
+      // keep normal numbers, flush denormals, inf and nan (like fpclassify() in UNDENORMAL())
+      float32x4_t a = vabsq_f32(v);
+      uint32x4_t normal = vandq_u32(vcgeq_f32(a, vdupq_n_f32(FLT_MIN)), vcleq_f32(a, vdupq_n_f32(FLT_MAX)));
+      return vec4(vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(v), normal)));
+#endif
+    }
+  };
+#endif
+
+  /**
+   * The unnormalized fast Walsh-Hadamard transform of the 4*NV values in
+   * the vectors x[0]~x[NV-1] (Sylvester order, H2N = {{HN, HN}, {HN, -HN}}).
+   * The recursion is resolved at compile time, NV is a power of 2.
+   */
+  template<typename T, long NV>
+  struct fwht
+  {
+    static inline void process(vec4<T> * x)
+    {
+      fwht<T,NV/2>::process(x);
+      fwht<T,NV/2>::process(x+NV/2);
+      for(long v = 0;v < NV/2;v ++)
+        {
+          vec4<T> t = x[v] - x[v+NV/2]; x[v] = x[v] + x[v+NV/2]; x[v+NV/2] = t;
+        }
+    }
+  };
+
+  template<typename T>
+  struct fwht<T,1>
+  {
+    static inline void process(vec4<T> * x)
+    {
+      const vec4<T> sign1(1, -1, 1, -1), sign2(1, 1, -1, -1);
+      x[0] = x[0].swappairs() + x[0] * sign1;
+      x[0] = x[0].swaphalves() + x[0] * sign2;
+    }
+  };
+};
+
+#endif
@@ -39,13 +39,17 @@ FV3_(zrev)::FV3_(zrev)()
   lfo1freq = 0.9;
   lfo2freq = 1.3;
   lfofactor = 0.31;
+  numdelays = FV3_ZREV_NUM_DELAYS;
+  lengthReal = delayLengthReal;
+  lengthDiff = delayLengthDiff;
   setFsFactors();
 }
 
 void FV3_(zrev)::mute()
 {
   FV3_(revbase)::mute();
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++){ _diff1[i].mute(); _delay[i].mute(); _filt1[i].mute(); }
+  for(long i = 0;i < numdelays;i ++){ _diff1[i].mute(); _delay[i].mute(); }
+  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++) _filt1[i].mute();
   lfo1.mute(); lfo2.mute(); lfo1_lpf.mute(); lfo2_lpf.mute();
   dccutL.mute(), dccutR.mute(); out1_lpf.mute(); out2_lpf.mute(); out1_hpf.mute(); out2_hpf.mute();
 }
@@ -53,6 +57,7 @@ void FV3_(zrev)::mute()
 void FV3_(zrev)::processreplace(fv3_float_t *inputL, fv3_float_t *inputR, fv3_float_t *outputL, fv3_float_t *outputR, long numsamples)
 {
   if(numsamples <= 0) return;
+  if(monoInput) inputR = inputL;
   long count = numsamples;
 
   fv3_float_t outL, outR;
@@ -123,10 +128,10 @@ void FV3_(zrev)::processreplace(fv3_float_t *inputL, fv3_float_t *inputR, fv3_fl
 void FV3_(zrev)::setrt60(fv3_float_t value)
 {
   rt60 = value;
-  fv3_float_t gain = std::sqrt(1./(fv3_float_t)FV3_ZREV_NUM_DELAYS);
+  fv3_float_t gain = std::sqrt(1./(fv3_float_t)numdelays);
   fv3_float_t back = rt60 * getTotalSampleRate();
   if(rt60 <= 0){ gain = 0; back = 1; }
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++)
+  for(long i = 0;i < numdelays;i ++)
     {
       _delay[i].setfeedback(gain*std::pow((fv3_float_t)10, (fv3_float_t)-3. * (fv3_float_t)(_delay[i].getsize() + _diff1[i].getsize()) / back));
     }
@@ -141,7 +146,7 @@ void FV3_(zrev)::setapfeedback(fv3_float_t value)
 {
   fv3_float_t rev = 1;
   apfeedback = value;
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++)
+  for(long i = 0;i < numdelays;i ++)
     {
       _diff1[i].setfeedback(rev*value);
       rev *= -1;
@@ -223,9 +228,12 @@ fv3_float_t FV3_(zrev)::getlfofactor(){ return lfofactor; }
 void FV3_(zrev)::setFsFactors()
 {
   FV3_(revbase)::setFsFactors();
-  const fv3_float_t *Total = delayLengthReal, *Diff = delayLengthDiff;
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++) _delay[i].setsize(p_(Total[i]-Diff[i],getTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++) _diff1[i].setsize(p_(Diff[i],getTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
+  const fv3_float_t *Total = lengthReal, *Diff = lengthDiff;
+  // allocate for the largest room size, resizing below only moves the read positions
+  for(long i = 0;i < numdelays;i ++) _delay[i].setmaxsize(p_(Total[i]-Diff[i],getMaxTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
+  for(long i = 0;i < numdelays;i ++) _diff1[i].setmaxsize(p_(Diff[i],getMaxTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
+  for(long i = 0;i < numdelays;i ++) _delay[i].setsize(p_(Total[i]-Diff[i],getTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
+  for(long i = 0;i < numdelays;i ++) _diff1[i].setsize(p_(Diff[i],getTotalFactorFs()), f_(delay_EXCURSION,getTotalSampleRate()));
   setrt60(getrt60());
   setapfeedback(getapfeedback());
   setloopdamp(getloopdamp());
@@ -236,4 +244,11 @@ void FV3_(zrev)::setFsFactors()
   setlfo2freq(getlfo2freq());
 }
 
+void FV3_(zrev)::setbuffers()
+{
+  for(long i = 0;i < numdelays;i ++) arena.place(_diff1[i]);
+  for(long i = 0;i < numdelays;i ++) arena.place(_delay[i]);
+  FV3_(revbase)::setbuffers();
+}
+
 #include "freeverb/fv3_ns_end.h"
@@ -29,6 +29,7 @@
 #include "freeverb/fv3_defs.h"
 
 #define FV3_ZREV_NUM_DELAYS 8
+#define FV3_ZREV_MAX_DELAYS 32
 
 namespace fv3
 {
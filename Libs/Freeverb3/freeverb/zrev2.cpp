@@ -28,6 +28,44 @@ const long FV3_(zrev2)::iAllpassLCo[] = {617, 535, 434, 347, 218, 162, 144, 122,
 const long FV3_(zrev2)::iAllpassRCo[] = {603, 547, 416, 364, 236, 162, 140, 131, 111, 79,};
 const long FV3_(zrev2)::allpM_EXCURSION = 32;
 
+// The delay line lengths of the other FDN orders in s, in the range of the 8
+// lines of zrev. The 4 lines are the lines 0, 3, 5 and 6 of them, the 16 and
+// 32 lines are log-spaced with the real lengths in bit-reversed order and the
+// diffuser lengths in golden ratio order, so that neither the neighbouring
+// lines nor the two lengths of a line are correlated.
+const fv3_float_t FV3_(zrev2)::delayLengthReal4[] = { .153129, .256891, .192303, .125000, };
+const fv3_float_t FV3_(zrev2)::delayLengthDiff4[] = { .020346, .027333, .029291, .013458, };
+const fv3_float_t FV3_(zrev2)::delayLengthReal16[] = {
+  .125000, .184181, .151209, .221309, .136230, .200225, .168352, .246849,
+  .132035, .193316, .158071, .232865, .145516, .214018, .173392, .254343, };
+const fv3_float_t FV3_(zrev2)::delayLengthDiff16[] = {
+  .013571, .023745, .016743, .029843, .021426, .015010, .026377, .018993,
+  .031400, .022333, .016114, .028403, .019871, .014210, .025363, .017963, };
+const fv3_float_t FV3_(zrev2)::delayLengthReal32[] = {
+  .125000, .182459, .151053, .220221, .136937, .197421, .164371, .237339,
+  .129642, .188575, .156270, .227754, .145089, .209603, .174474, .251631,
+  .128803, .185629, .154664, .222781, .139647, .203897, .168720, .246366,
+  .135088, .196321, .162945, .236249, .145774, .211231, .175370, .254730, };
+const fv3_float_t FV3_(zrev2)::delayLengthDiff32[] = {
+  .013571, .023122, .016939, .028357, .020210, .014755, .025268, .018360,
+  .030538, .022141, .015924, .026532, .019387, .013798, .024214, .017145,
+  .028867, .021117, .014887, .026294, .018541, .031604, .022824, .016178,
+  .027687, .019781, .014154, .024572, .017701, .030208, .021317, .015510, };
+
+// The stereo outputs are x0-x1+x2-x3 and x4+x5-x6-x7. x3 and x7 are louder
+// than the other lines (about 1.6-1.8 times), so further sign patterns of
+// all lines would be correlated with the stereo outputs through them. These
+// taps leave out x3 and x7, are orthogonal to the stereo taps and to each
+// other on the remaining lines and have about the level of the stereo
+// outputs. The ambisonic output of zita-rev1 (single lines x0, x1, x4 and
+// x2) would be correlated with the stereo outputs, which contain x1 and x2.
+const fv3_float_t FV3_(zrev2)::outputTaps[FV3_ZREV2_MAX_OUTPUTS-2][FV3_ZREV_NUM_DELAYS] = {
+  {1.66666667, 1.66666667, 0, 0, 0, 0, 0, 0,},
+  {0, 0, 0, 0, 1.66666667, -1.66666667, 0, 0,},
+  {-0.96225045, 0.96225045, 1.92450090, 0, 0, 0, 0, 0,},
+  {0, 0, 0, 0, 0.96225045, 0.96225045, 1.92450090, 0,},
+};
+
 FV3_(zrev2)::FV3_(zrev2)()
 {
   rt60 = 2.0;
@@ -39,6 +77,8 @@ FV3_(zrev2)::FV3_(zrev2)()
   wander_ms = 22;
   spin_fq = 2.4;
   spin_factor = 0.3;
+  numoutputs = 2;
+  decaypending = true;
 
   setFsFactors();
 }
@@ -46,16 +86,22 @@ FV3_(zrev2)::FV3_(zrev2)()
 void FV3_(zrev2)::mute()
 {
   FV3_(zrev)::mute();
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++){ _lsf0[i].mute(); _hsf0[i].mute(); }
   for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++){ iAllpassL[i].mute(); iAllpassR[i].mute(); }
+  for(long v = 0;v < numdelays/4;v ++){ lsfv[v].mute(); hsfv[v].mute(); }
   spin1_lfo.mute(); spin1_lpf.mute(); spincombl.mute(); spincombr.mute();
+  for(long c = 0;c < FV3_ZREV2_MAX_OUTPUTS-2;c ++)
+    {
+      spincombx[c].mute(); outx_lpf[c].mute(); outx_hpf[c].mute(); delayWX[c].mute();
+    }
 }
 
 void FV3_(zrev2)::processreplace(fv3_float_t *inputL, fv3_float_t *inputR, fv3_float_t *outputL, fv3_float_t *outputR, long numsamples)
 {
+  if(decaypending) updatedecay();
   switch(reverbType)
     {
     case FV3_REVTYPE_ZREV:
+      if(numdelays != FV3_ZREV_NUM_DELAYS) break;
       FV3_(zrev)::processreplace(inputL, inputR, outputL, outputR, numsamples);
       return;
     case FV3_REVTYPE_SELF:
@@ -64,105 +110,174 @@ void FV3_(zrev2)::processreplace(fv3_float_t *inputL, fv3_float_t *inputR, fv3_f
       ;
     }
 
-  if(numsamples <= 0) return;
-  long count = numsamples;
+  bufferio io = {inputL, inputR, outputL, outputR,};
+  processio(io, numsamples);
+}
+
+void FV3_(zrev2)::setMonoInput(bool value)
+{
+  // the right input side wasn't processed, it starts again from silence
+  if(monoInput&&!value)
+    {
+      dccutR.mute(); delayR.mute();
+      for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++) iAllpassR[i].mute();
+    }
+  FV3_(zrev)::setMonoInput(value);
+}
+
+void FV3_(zrev2)::setnumoutputs(long value)
+{
+  if(value < 2) value = 2;
+  if(value > FV3_ZREV2_MAX_OUTPUTS) value = FV3_ZREV2_MAX_OUTPUTS;
+  if(value == numoutputs) return;
+  numoutputs = value;
+  setextraoutputs();
+  allocbuffers();
+  mute();
+}
+
+long FV3_(zrev2)::getnumoutputs() const
+{
+  return numoutputs;
+}
+
+void FV3_(zrev2)::setnumdelays(long value)
+{
+  const fv3_float_t *real, *diff;
+  switch(value)
+    {
+    case 4: real = delayLengthReal4; diff = delayLengthDiff4; break;
+    case 8: real = delayLengthReal; diff = delayLengthDiff; break;
+    case 16: real = delayLengthReal16; diff = delayLengthDiff16; break;
+    case 32: real = delayLengthReal32; diff = delayLengthDiff32; break;
+    default: return;
+    }
+  if(value == numdelays) return;
+  // the lines which aren't used any more don't keep their buffers
+  for(long i = value;i < numdelays;i ++){ _diff1[i].free(); _delay[i].free(); }
+  numdelays = value;
+  lengthReal = real;
+  lengthDiff = diff;
+  setFsFactors();
+  allocbuffers();
+  mute();
+}
+
+long FV3_(zrev2)::getnumdelays() const
+{
+  return numdelays;
+}
+
+void FV3_(zrev2)::setoutputlpf(fv3_float_t value)
+{
+  FV3_(zrev)::setoutputlpf(value);
+  for(long c = 0;c < FV3_ZREV2_MAX_OUTPUTS-2;c ++) outx_lpf[c].setLPF_BW(outputlpf, getTotalSampleRate());
+}
+
+void FV3_(zrev2)::setoutputhpf(fv3_float_t value)
+{
+  FV3_(zrev)::setoutputhpf(value);
+  for(long c = 0;c < FV3_ZREV2_MAX_OUTPUTS-2;c ++) outx_hpf[c].setHPF_BW(outputhpf, getTotalSampleRate());
+}
 
-  fv3_float_t outL, outR;
+void FV3_(zrev2)::setInitialDelay(long numsamples)
+{
+  FV3_(zrev)::setInitialDelay(numsamples);
+  setextraoutputs();
+}
 
-  while(count-- > 0)
+void FV3_(zrev2)::setextraoutputs()
+{
+  // the unused outputs keep their buffers, but aren't resized any more
+  for(long c = 0;c < numoutputs-2;c ++)
     {
-      fv3_float_t lfo1q = lfo1_lpf(lfo1()*lfofactor);
-      fv3_float_t lfo2q = lfo2_lpf(lfo2()*lfofactor);
-      // if(lfo1q < -1.) lfo1q = -1.; if(lfo1q > 1.) lfo1q = 1.;
-      // if(lfo2q < -1.) lfo2q = -1.; if(lfo2q > 1.) lfo2q = 1.;
-      fv3_float_t lfo1p = -1 * lfo1q;
-      fv3_float_t lfo2p = -1 * lfo2q;
-
-      outL = dccutL(*inputL); outR = dccutR(*inputR);
-
-      // input diffusion
-      fv3_float_t i_sign = -1;
-      for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++)
-        {
-          outL = iAllpassL[i]._process(outL, lfo1q*i_sign);
-          outR = iAllpassR[i]._process(outR, lfo2p*i_sign);
-          i_sign *= -1;
-        }
-
-      fv3_float_t t, x0, x1, x2, x3, x4, x5, x6, x7;
-      t = outL;
-      x0 = _diff1[0]._process(_lsf0[0](_hsf0[0](_delay[0]._getlast() + t)), lfo1q);
-      x1 = _diff1[1]._process(_lsf0[1](_hsf0[1](_delay[1]._getlast() + t)), lfo1p);
-      x2 = _diff1[2]._process(_lsf0[2](_hsf0[2](_delay[2]._getlast() - t)), lfo1q);
-      x3 = _diff1[3]._process(_lsf0[3](_hsf0[3](_delay[3]._getlast() - t)), lfo1p);
-      t = outR;
-      x4 = _diff1[4]._process(_lsf0[4](_hsf0[4](_delay[4]._getlast() + t)), lfo2p);
-      x5 = _diff1[5]._process(_lsf0[5](_hsf0[5](_delay[5]._getlast() + t)), lfo2q);
-      x6 = _diff1[6]._process(_lsf0[6](_hsf0[6](_delay[6]._getlast() - t)), lfo2p);
-      x7 = _diff1[7]._process(_lsf0[7](_hsf0[7](_delay[7]._getlast() - t)), lfo2q);
-
-      t = x0 - x1; x0 += x1;  x1 = t;
-      t = x2 - x3; x2 += x3;  x3 = t;
-      t = x4 - x5; x4 += x5;  x5 = t;
-      t = x6 - x7; x6 += x7;  x7 = t;
-      t = x0 - x2; x0 += x2;  x2 = t;
-      t = x1 - x3; x1 += x3;  x3 = t;
-      t = x4 - x6; x4 += x6;  x6 = t;
-      t = x5 - x7; x5 += x7;  x7 = t;
-      t = x0 - x4; x0 += x4;  x4 = t;
-      t = x1 - x5; x1 += x5;  x5 = t;
-      t = x2 - x6; x2 += x6;  x6 = t;
-      t = x3 - x7; x3 += x7;  x7 = t;
-
-      _delay[0]._process(x0, lfo2q);
-      _delay[1]._process(x1, lfo1q);
-      _delay[2]._process(x2, lfo2p);
-      _delay[3]._process(x3, lfo1p);
-      _delay[4]._process(x4, lfo1p);
-      _delay[5]._process(x5, lfo2q);
-      _delay[6]._process(x6, lfo1p);
-      _delay[7]._process(x7, lfo2q);
-
-      outL = .2*(x0 - x1 + x2 - x3);
-      outR = .2*(x4 + x5 - x6 - x7);
-
-      fv3_float_t spinlfo = spin1_lpf(spin1_lfo()*spin_factor);
-      outL = spincombl._process_ff(outL, spinlfo);
-      outR = spincombr._process_ff(outR, spinlfo*-1);
-
-      fv3_float_t fpL = delayWL(out1_lpf(out1_hpf(outL)));
-      fv3_float_t fpR = delayWR(out2_lpf(out2_hpf(outR)));
-      *outputL = fpL*wet1 + fpR*wet2 + delayL(*inputL)*dry;
-      *outputR = fpR*wet1 + fpL*wet2 + delayR(*inputR)*dry;
-      UNDENORMAL(*outputL); UNDENORMAL(*outputR);
-      inputL ++; inputR ++; outputL ++; outputR ++;
+      spincombx[c].setmaxsize(spincombl.getbufsize());
+      spincombx[c].setsize(spincombl.getsize());
+      delayWX[c].setmaxsize(delayWL.getmaxsize());
+      delayWX[c].setglide(delayWL.getglide());
+      delayWX[c].setsize(delayWL.getsize());
     }
 }
 
+void FV3_(zrev2)::setPreDelayGlide(fv3_float_t speed)
+{
+  FV3_(zrev)::setPreDelayGlide(speed);
+  setextraoutputs();
+}
+
+void FV3_(zrev2)::settlePreDelay()
+{
+  FV3_(zrev)::settlePreDelay();
+  for(long c = 0;c < FV3_ZREV2_MAX_OUTPUTS-2;c ++) delayWX[c].settle();
+}
+
 void FV3_(zrev2)::setrt60(fv3_float_t value)
 {
   rt60 = value;
-  fv3_float_t gain = std::sqrt(1./(fv3_float_t)FV3_ZREV_NUM_DELAYS);
-  fv3_float_t back = rt60 * getTotalSampleRate();
+  decaypending = true;
+}
+
+void FV3_(zrev2)::updatedecay()
+{
+  // The loop gain of a line is 10^y with y = -3*length/(rt60*fs), the
+  // shelves scale y by (1-f)/f. The shelf gains A = 10^(dB/40) are computed
+  // from y directly instead of through dB, the RBJ slope is 1 (so that
+  // b = sqrt(2A)) and the angle of each crossover is the same for all lines.
+  decaypending = false;
+  const fv3_float_t fs = getTotalSampleRate();
+  fv3_float_t gain = std::sqrt(1./(fv3_float_t)numdelays);
+  fv3_float_t back = rt60 * fs;
   if(rt60 <= 0){ gain = 0; back = 1; }
-  for(long i = 0;i < FV3_ZREV_NUM_DELAYS;i ++)
+  const fv3_float_t ln10 = std::log((fv3_float_t)10);
+  const fv3_float_t klow = ln10 * (fv3_float_t).5 / rt60_f_low * (1 - rt60_f_low);
+  const fv3_float_t khigh = ln10 * (fv3_float_t).5 / rt60_f_high * (1 - rt60_f_high);
+  // the crossovers are already limited to fs/2 like in biquad
+  const fv3_float_t wlow = 2.0 * M_PI * (rt60_xo_low < 1 ? 1 : rt60_xo_low) / fs;
+  const fv3_float_t whigh = 2.0 * M_PI * (rt60_xo_high < 1 ? 1 : rt60_xo_high) / fs;
+  const fv3_float_t cwlow = std::cos(wlow), swlow = std::sin(wlow);
+  const fv3_float_t cwhigh = std::cos(whigh), swhigh = std::sin(whigh);
+
+  fv3_float_t cl[5][FV3_ZREV_MAX_DELAYS], ch[5][FV3_ZREV_MAX_DELAYS];
+  for(long i = 0;i < numdelays;i ++)
     {
-      _delay[i].setfeedback(gain*std::pow((fv3_float_t)10, (fv3_float_t)-3. * (fv3_float_t)(_delay[i].getsize() + _diff1[i].getsize()) / back));
-      _lsf0[i].setLSF_RBJ(rt60_xo_low,
-			  FV3_(utils)::R2dB(std::pow((fv3_float_t)10, (fv3_float_t)-3. * (fv3_float_t)(_delay[i].getsize() + _diff1[i].getsize())
-							  / back / rt60_f_low * (1 - rt60_f_low))),
-			  1, getTotalSampleRate());
-      _hsf0[i].setHSF_RBJ(rt60_xo_high,
-			  FV3_(utils)::R2dB(std::pow((fv3_float_t)10, (fv3_float_t)-3. * (fv3_float_t)(_delay[i].getsize() + _diff1[i].getsize())
-							  / back / rt60_f_high * (1 - rt60_f_high))),
-			  1, getTotalSampleRate());
+      fv3_float_t y = (fv3_float_t)-3. * (fv3_float_t)(_delay[i].getsize() + _diff1[i].getsize()) / back;
+      _delay[i].setfeedback(gain*std::exp(ln10*y));
+
+      // low shelf, the same as biquad::setLSF_RBJ()
+      fv3_float_t A = std::exp(y*klow);
+      fv3_float_t apc = cwlow * (A + 1.0), amc = cwlow * (A - 1.0), bs = std::sqrt(2 * A) * swlow;
+      fv3_float_t a0r = 1.0 / (A + 1.0 + amc + bs);
+      cl[0][i] = a0r * A * (A + 1.0 - amc + bs);
+      cl[1][i] = a0r * 2.0 * A * (A - 1.0 - apc);
+      cl[2][i] = a0r * A * (A + 1.0 - amc - bs);
+      cl[3][i] = -1.0 * a0r * 2.0 * (A - 1.0 + apc);
+      cl[4][i] = -1.0 * a0r * (-A - 1.0 - amc + bs);
+
+      // high shelf, the same as biquad::setHSF_RBJ()
+      A = std::exp(y*khigh);
+      apc = cwhigh * (A + 1.0); amc = cwhigh * (A - 1.0); bs = std::sqrt(2 * A) * swhigh;
+      a0r = 1.0 / (A + 1.0 - amc + bs);
+      ch[0][i] = a0r * A * (A + 1.0 + amc + bs);
+      ch[1][i] = a0r * -2.0 * A * (A - 1.0 + apc);
+      ch[2][i] = a0r * A * (A + 1.0 + amc - bs);
+      ch[3][i] = -1.0 * a0r * -2.0 * (A - 1.0 - apc);
+      ch[4][i] = -1.0 * a0r * (-A - 1.0 + amc + bs);
+    }
+
+  for(long v = 0;v < numdelays/4;v ++)
+    {
+      lsfv[v].b0 = vec4<fv3_float_t>::load(cl[0]+4*v); hsfv[v].b0 = vec4<fv3_float_t>::load(ch[0]+4*v);
+      lsfv[v].b1 = vec4<fv3_float_t>::load(cl[1]+4*v); hsfv[v].b1 = vec4<fv3_float_t>::load(ch[1]+4*v);
+      lsfv[v].b2 = vec4<fv3_float_t>::load(cl[2]+4*v); hsfv[v].b2 = vec4<fv3_float_t>::load(ch[2]+4*v);
+      lsfv[v].a1 = vec4<fv3_float_t>::load(cl[3]+4*v); hsfv[v].a1 = vec4<fv3_float_t>::load(ch[3]+4*v);
+      lsfv[v].a2 = vec4<fv3_float_t>::load(cl[4]+4*v); hsfv[v].a2 = vec4<fv3_float_t>::load(ch[4]+4*v);
     }
 }
 
 void FV3_(zrev2)::setrt60_factor_low(fv3_float_t gain)
 {
   rt60_f_low = gain;
-  setrt60(getrt60());
+  decaypending = true;
 }
 
 fv3_float_t FV3_(zrev2)::getrt60_factor_low() const
@@ -173,7 +288,7 @@ fv3_float_t FV3_(zrev2)::getrt60_factor_low() const
 void FV3_(zrev2)::setrt60_factor_high(fv3_float_t gain)
 {
   rt60_f_high = gain;
-  setrt60(getrt60());
+  decaypending = true;
 }
 
 fv3_float_t FV3_(zrev2)::getrt60_factor_high() const
@@ -189,7 +304,7 @@ void FV3_(zrev2)::setloopdamp(fv3_float_t value)
 void FV3_(zrev2)::setxover_low(fv3_float_t fc)
 {
   rt60_xo_low = limFs2(fc);
-  setrt60(getrt60());
+  decaypending = true;
 }
 
 fv3_float_t FV3_(zrev2)::getxover_low() const
@@ -201,7 +316,7 @@ void FV3_(zrev2)::setxover_high(fv3_float_t fc)
 {
   FV3_(zrev)::setloopdamp(fc);
   rt60_xo_high = limFs2(fc);
-  setrt60(getrt60());
+  decaypending = true;
 }
 
 fv3_float_t FV3_(zrev2)::getxover_high() const
@@ -227,9 +342,11 @@ fv3_float_t FV3_(zrev2)::getidiffusion1() const
 void FV3_(zrev2)::setwander(fv3_float_t ms)
 {
   if(ms < 0) ms = 0;
+  if(ms > FV3_ZREV2_MAX_WANDER) ms = FV3_ZREV2_MAX_WANDER;
   wander_ms = ms;
   spincombl.setsize(p_(wander_ms, getTotalSampleRate()*0.001));
   spincombr.setsize(p_(wander_ms, getTotalSampleRate()*0.001));
+  setextraoutputs();
 }
 
 fv3_float_t FV3_(zrev2)::getwander() const
@@ -253,20 +370,32 @@ void FV3_(zrev2)::setFsFactors()
 {
   FV3_(zrev)::setFsFactors();
   fv3_float_t totalFactor = getTotalFactorFs()/(fv3_float_t)FV3_ZREV2_ALLPASS_FS;
+  fv3_float_t maxTotalFactor = getMaxTotalFactorFs()/(fv3_float_t)FV3_ZREV2_ALLPASS_FS;
   fv3_float_t excurFactor = getTotalSampleRate()/(fv3_float_t)FV3_ZREV2_ALLPASS_FS;
 
   for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++)
     {
+      iAllpassL[i].setmaxsize(p_(iAllpassLCo[i],maxTotalFactor), p_(allpM_EXCURSION/3,excurFactor));
+      iAllpassR[i].setmaxsize(p_(iAllpassRCo[i],maxTotalFactor), p_(allpM_EXCURSION/3,excurFactor));
       iAllpassL[i].setsize(p_(iAllpassLCo[i],totalFactor), p_(allpM_EXCURSION/3,excurFactor));
       iAllpassR[i].setsize(p_(iAllpassRCo[i],totalFactor), p_(allpM_EXCURSION/3,excurFactor));
     }
 
-  setrt60(getrt60());
   setxover_low(getxover_low());
   setxover_high(getxover_high());
   setidiffusion1(getidiffusion1());
+  spincombl.setmaxsize(p_((fv3_float_t)FV3_ZREV2_MAX_WANDER, getTotalSampleRate()*0.001));
+  spincombr.setmaxsize(p_((fv3_float_t)FV3_ZREV2_MAX_WANDER, getTotalSampleRate()*0.001));
   setwander(getwander());
   setspin(getspin());
 }
 
+void FV3_(zrev2)::setbuffers()
+{
+  for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++){ arena.place(iAllpassL[i]); arena.place(iAllpassR[i]); }
+  FV3_(zrev)::setbuffers();
+  arena.place(spincombl); arena.place(spincombr);
+  for(long c = 0;c < FV3_ZREV2_MAX_OUTPUTS-2;c ++){ arena.place(spincombx[c]); arena.place(delayWX[c]); }
+}
+
 #include "freeverb/fv3_ns_end.h"
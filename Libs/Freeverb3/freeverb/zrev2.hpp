@@ -24,10 +24,14 @@
 
 #include "freeverb/zrev.hpp"
 #include "freeverb/biquad.hpp"
+#include "freeverb/vec4.hpp"
 #include "freeverb/fv3_defs.h"
 
 #define FV3_ZREV2_ALLPASS_FS 34125
 #define FV3_ZREV2_NUM_IALLPASS 10
+#define FV3_ZREV2_MAX_VECTORS (FV3_ZREV_MAX_DELAYS/4)
+#define FV3_ZREV2_MAX_OUTPUTS 6
+#define FV3_ZREV2_MAX_WANDER 100
 
 namespace fv3
 {
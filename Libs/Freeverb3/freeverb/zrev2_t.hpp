@@ -27,8 +27,70 @@ public:
   virtual void mute();
   virtual void processreplace(_fv3_float_t *inputL, _fv3_float_t *inputR, _fv3_float_t *outputL, _fv3_float_t *outputR, long numsamples);
 
+  /**
+   * The zrev2 algorithm with the input and output of each sample handed
+   * through io, so that callers can mix other signals into the input and
+   * the output without intermediate buffers. io provides
+   * read(_fv3_float_t& inputL, _fv3_float_t& inputR) and
+   * write(const _fv3_float_t * outputs) with getnumoutputs() samples, which
+   * are called once per sample in this order. The reverb type is not checked.
+   * @param[in] io The input and output of the samples.
+   * @param[in] numsamples The number of samples.
+   */
+  template<class IO> void processio(IO& io, long numsamples)
+  {
+    if(numsamples <= 0) return;
+    if(decaypending) updatedecay();
+    switch(numdelays)
+      {
+      case 4: _processio<4>(io, numsamples); break;
+      case 16: _processio<16>(io, numsamples); break;
+      case 32: _processio<32>(io, numsamples); break;
+      default: _processio<8>(io, numsamples); break;
+      }
+  }
+
+  /**
+   * set the number of delay lines of the FDN. 4 lines are a sparser and
+   * slightly cheaper version of the 8 lines of zita-rev1, 16 and 32 lines
+   * give a denser tail. The feedback matrix is always a Hadamard matrix. The
+   * zrev reverb type needs 8 lines, the other orders are processed as
+   * zrev2. With 4 lines the outputs after the stereo pair repeat the stereo
+   * outputs (apart from their own modulation comb, filters and predelay).
+   * The buffers are reallocated, so this must not be called while
+   * processing.
+   * @param[in] value The number of delay lines, 4, 8, 16 or 32.
+   */
+  void setnumdelays(long value);
+  long getnumdelays() const;
+
+  /**
+   * set the number of outputs of processio(). The first two are the stereo
+   * outputs, the others are further taps of the FDN, which are decorrelated
+   * from each other and from the stereo outputs. Each of them has its own
+   * modulation comb, output filters and predelay, but neither the stereo
+   * width nor the dry signal. processreplace() only writes the stereo
+   * outputs. The buffers are reallocated, so this must not be called while
+   * processing.
+   * @param[in] value The number of outputs in 2~FV3_ZREV2_MAX_OUTPUTS.
+   */
+  void setnumoutputs(long value);
+  long getnumoutputs() const;
+
+  virtual void setoutputlpf(_fv3_float_t value);
+  virtual void setoutputhpf(_fv3_float_t value);
+
+  /**
+   * In the mono input mode the DC cut, the input diffusion and the dry
+   * delay of the left channel feed both halves of the FDN, the right ones
+   * are not processed.
+   */
+  virtual void setMonoInput(bool value);
+
   virtual void setrt60(_fv3_float_t value);
   virtual void setloopdamp(_fv3_float_t value);
+  virtual void setPreDelayGlide(_fv3_float_t speed);
+  virtual void settlePreDelay();
 
   void setrt60_factor_low(_fv3_float_t gain);
   _fv3_float_t getrt60_factor_low() const;
@@ -49,8 +111,9 @@ public:
   _fv3_float_t getidiffusion1() const;
 
   /**
-   * set the comb filter length for the modulation.
-   * @param[in] value The comb filter length in ms.
+   * set the comb filter length for the modulation. The combs are allocated
+   * for FV3_ZREV2_MAX_WANDER ms in setFsFactors(), so this never allocates.
+   * @param[in] value The comb filter length in ms, 0~FV3_ZREV2_MAX_WANDER.
    */
   void setwander(_fv3_float_t ms);
   _fv3_float_t getwander() const;
@@ -68,10 +131,224 @@ public:
   _FV3_(zrev2)(const _FV3_(zrev2)& x);
   _FV3_(zrev2)& operator=(const _FV3_(zrev2)& x);
   virtual void setFsFactors();
+  virtual void setbuffers();
+  virtual void setInitialDelay(long numsamples);
+  /**
+   * Recompute the loop gains and the loop filters of all lines. The decay
+   * setters and setFsFactors() only mark them as changed, so that any number
+   * of changes between two blocks costs one recompute at the next block.
+   */
+  void updatedecay();
+  bool decaypending;
+  void setextraoutputs();
   _fv3_float_t rt60_f_low, rt60_f_high, rt60_xo_low, rt60_xo_high, idiff1, wander_ms, spin_fq, spin_factor;
-  _FV3_(biquad) _lsf0[FV3_ZREV_NUM_DELAYS], _hsf0[FV3_ZREV_NUM_DELAYS];
   _FV3_(allpassm) iAllpassL[FV3_ZREV2_NUM_IALLPASS], iAllpassR[FV3_ZREV2_NUM_IALLPASS];
   _FV3_(lfo) spin1_lfo; _FV3_(iir_1st) spin1_lpf;
   const static long iAllpassLCo[FV3_ZREV2_NUM_IALLPASS], iAllpassRCo[FV3_ZREV2_NUM_IALLPASS], allpM_EXCURSION;
+  const static _fv3_float_t delayLengthReal4[4], delayLengthDiff4[4], delayLengthReal16[16], delayLengthDiff16[16];
+  const static _fv3_float_t delayLengthReal32[32], delayLengthDiff32[32];
   _FV3_(comb) spincombl, spincombr;
+
+  // The outputs after the stereo pair, only the first numoutputs-2 are sized
+  // and processed.
+  long numoutputs;
+  const static _fv3_float_t outputTaps[FV3_ZREV2_MAX_OUTPUTS-2][FV3_ZREV_NUM_DELAYS];
+  _FV3_(comb) spincombx[FV3_ZREV2_MAX_OUTPUTS-2];
+  _FV3_(iir_1st) outx_lpf[FV3_ZREV2_MAX_OUTPUTS-2], outx_hpf[FV3_ZREV2_MAX_OUTPUTS-2];
+  _FV3_(delayg) delayWX[FV3_ZREV2_MAX_OUTPUTS-2];
+
+  template<long N, class IO> void _processio(IO& io, long numsamples)
+  {
+    if(numoutputs > 2)
+      {
+        if(monoInput) _processfdn<N,true,true>(io, numsamples);
+        else _processfdn<N,false,true>(io, numsamples);
+      }
+    else
+      {
+        if(monoInput) _processfdn<N,true,false>(io, numsamples);
+        else _processfdn<N,false,false>(io, numsamples);
+      }
+  }
+
+  // The modulation of line i is the one of line modindex() of the 8 lines,
+  // 4 lines are the lines 0, 3, 5 and 6 of them.
+  static inline long modindex(long N, long i)
+  {
+    if(N == 4) return i == 0 ? 0 : i == 1 ? 3 : i == 2 ? 5 : 6;
+    return i%8;
+  }
+
+  template<long N, bool mono, bool multi, class IO> void _processfdn(IO& io, long numsamples)
+  {
+    long count = numsamples;
+    const long NV = N/4;
+
+    _fv3_float_t inL, inR, outL, outR, outputs[FV3_ZREV2_MAX_OUTPUTS];
+
+    // The N delay lines are processed as vectors of 4 lines (x0-x3, x4-x7...).
+    // The modulated read positions are computed per line, everything else
+    // (interpolation, loop filters, diffusers, Hadamard matrix and feedback)
+    // is done with vector operations in the same order as the scalar version.
+    typedef vec4<_fv3_float_t> fdnvec;
+    const fdnvec inj_sign(1, 1, -1, -1), inj_sign4(1, -1, 1, -1);
+    // the level of the lines grows with sqrt(N), the stereo outputs are sums
+    // of N/2 lines and the other outputs of up to 3 lines, this keeps the
+    // output levels of 8 lines
+    const double tapgain = 1.6/N, tapgainx = N == 16 ? .14142136 : N == 32 ? .1 : .2;
+    _fv3_float_t ra[N], rb[N], rf[N], w[N];
+    fdnvec diff_z1[NV], delay_z1[NV];
+    fdnvec diff_fb[NV], delay_fb[NV];
+    for(long v = 0, i = 0;v < NV;v ++, i += 4)
+      {
+        diff_z1[v] = fdnvec(_diff1[i]._getlast(), _diff1[i+1]._getlast(), _diff1[i+2]._getlast(), _diff1[i+3]._getlast());
+        delay_z1[v] = fdnvec(_delay[i]._getlast(), _delay[i+1]._getlast(), _delay[i+2]._getlast(), _delay[i+3]._getlast());
+        diff_fb[v] = fdnvec(_diff1[i].getfeedback(), _diff1[i+1].getfeedback(), _diff1[i+2].getfeedback(), _diff1[i+3].getfeedback());
+        delay_fb[v] = fdnvec(_delay[i].getfeedback(), _delay[i+1].getfeedback(), _delay[i+2].getfeedback(), _delay[i+3].getfeedback());
+      }
+
+    while(count-- > 0)
+      {
+        _fv3_float_t lfo1q = lfo1_lpf(lfo1()*lfofactor);
+        _fv3_float_t lfo2q = lfo2_lpf(lfo2()*lfofactor);
+        // if(lfo1q < -1.) lfo1q = -1.; if(lfo1q > 1.) lfo1q = 1.;
+        // if(lfo2q < -1.) lfo2q = -1.; if(lfo2q > 1.) lfo2q = 1.;
+        _fv3_float_t lfo1p = -1 * lfo1q;
+        _fv3_float_t lfo2p = -1 * lfo2q;
+
+        io.read(inL, inR);
+        if(mono)
+          {
+            outL = dccutL(inL);
+            // input diffusion
+            _fv3_float_t i_sign = -1;
+            for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++)
+              {
+                outL = iAllpassL[i]._process(outL, lfo1q*i_sign);
+                i_sign *= -1;
+              }
+            outR = outL;
+          }
+        else
+          {
+            outL = dccutL(inL); outR = dccutR(inR);
+            // input diffusion
+            _fv3_float_t i_sign = -1;
+            for(long i = 0;i < FV3_ZREV2_NUM_IALLPASS;i ++)
+              {
+                outL = iAllpassL[i]._process(outL, lfo1q*i_sign);
+                outR = iAllpassR[i]._process(outR, lfo2p*i_sign);
+                i_sign *= -1;
+              }
+          }
+
+        // the first half of the lines = _delay[i] +/- outL, the second half = _delay[i] +/- outR
+        fdnvec x[NV];
+        if(N == 4) x[0] = delay_z1[0] + fdnvec(outL, outL, outR, outR) * inj_sign4;
+        else for(long v = 0;v < NV;v ++) x[v] = delay_z1[v] + fdnvec(v < NV/2 ? outL : outR) * inj_sign;
+
+        const _fv3_float_t diff_mod[8] = {lfo1q, lfo1p, lfo1q, lfo1p, lfo2p, lfo2q, lfo2p, lfo2q,};
+        for(long i = 0;i < N;i ++) _diff1[i]._fetch(diff_mod[modindex(N,i)], &ra[i], &rb[i], &rf[i]);
+        for(long v = 0;v < NV;v ++)
+          {
+            x[v] = lsfv[v].process(hsfv[v].process(x[v]));
+            // _diff1[i]._process()
+            diff_z1[v] = (fdnvec::load(rb+4*v) + fdnvec::load(rf+4*v) * (fdnvec::load(ra+4*v) - diff_z1[v])).undenormal();
+            fdnvec input = x[v] + diff_z1[v] * diff_fb[v];
+            input.store(w+4*v);
+            x[v] = diff_z1[v] - input * diff_fb[v];
+          }
+        for(long i = 0;i < N;i ++) _diff1[i]._store(w[i]);
+
+        // Hadamard matrix
+        fwht<_fv3_float_t,NV>::process(x);
+
+        const _fv3_float_t delay_mod[8] = {lfo2q, lfo1q, lfo2p, lfo1p, lfo1p, lfo2q, lfo1p, lfo2q,};
+        for(long i = 0;i < N;i ++) _delay[i]._fetch(delay_mod[modindex(N,i)], &ra[i], &rb[i], &rf[i]);
+        for(long v = 0;v < NV;v ++)
+          {
+            // _delay[i]._process()
+            delay_z1[v] = (fdnvec::load(rb+4*v) + fdnvec::load(rf+4*v) * (fdnvec::load(ra+4*v) - delay_z1[v])).undenormal();
+            (delay_fb[v] * x[v]).store(w+4*v);
+          }
+        for(long i = 0;i < N;i ++) _delay[i]._store(w[i]);
+
+        // outL = x0-x1+x2-x3..., outR = x4+x5-x6-x7... with 8 lines
+        for(long v = 0;v < NV;v ++) x[v].store(w+4*v);
+        outL = outR = 0;
+        for(long i = 0;i < N/2;i ++) outL = (i & 1) ? outL - w[i] : outL + w[i];
+        for(long i = N/2;i < N;i ++) outR = (i & 2) ? outR - w[i] : outR + w[i];
+        outL = tapgain*outL;
+        outR = tapgain*outR;
+        const _fv3_float_t tapL = outL, tapR = outR;
+
+        _fv3_float_t spinlfo = spin1_lpf(spin1_lfo()*spin_factor);
+        outL = spincombl._process_ff(outL, spinlfo);
+        outR = spincombr._process_ff(outR, spinlfo*-1);
+
+        _fv3_float_t fpL = delayWL(out1_lpf(out1_hpf(outL)));
+        _fv3_float_t fpR = delayWR(out2_lpf(out2_hpf(outR)));
+        _fv3_float_t dryL = delayL(inL), dryR = mono ? dryL : delayR(inR);
+        outputs[0] = fpL*wet1 + fpR*wet2 + dryL*dry;
+        outputs[1] = fpR*wet1 + fpL*wet2 + dryR*dry;
+        UNDENORMAL(outputs[0]); UNDENORMAL(outputs[1]);
+
+        if(multi)
+          {
+            // the taps of line j of the 8 lines are used for line j of the
+            // first and line j-4 of the second half of the lines, 4 lines
+            // have no lines left which aren't correlated with the stereo
+            // outputs and repeat the stereo taps
+            for(long c = 0;c < numoutputs-2;c ++)
+              {
+                _fv3_float_t outX = 0;
+                if(N == 4) outX = (c&1) ? tapR : tapL;
+                else
+                  {
+                    for(long j = 0;j < 8;j ++) outX += outputTaps[c][j]*w[j < 4 ? j : N/2+j-4];
+                    outX = tapgainx*outX;
+                  }
+                outX = spincombx[c]._process_ff(outX, (c&1) ? spinlfo*-1 : spinlfo);
+                outputs[2+c] = delayWX[c](outx_lpf[c](outx_hpf[c](outX)))*wet;
+                UNDENORMAL(outputs[2+c]);
+              }
+          }
+        io.write(outputs);
+      }
+
+    for(long v = 0, i = 0;v < NV;v ++, i += 4)
+      {
+        diff_z1[v].store(ra); delay_z1[v].store(rb);
+        for(long j = 0;j < 4;j ++){ _diff1[i+j]._setlast(ra[j]); _delay[i+j]._setlast(rb[j]); }
+      }
+  }
+
+  // The FDN loop is processed in vectors of 4 delay lines. The loop filters
+  // are kept in SoA layout, their coefficients are computed by updatedecay().
+  struct loopfilter
+  {
+    vec4<_fv3_float_t> b0, b1, b2, a1, a2, i1, i2, o1, o2;
+
+    // Direct form I, the same as biquad::processd1()
+    inline vec4<_fv3_float_t> process(const vec4<_fv3_float_t>& input)
+    {
+      vec4<_fv3_float_t> output = input * b0;
+      output = output + (b1 * i1 + b2 * i2);
+      output = output - (a1 * o1 + a2 * o2);
+      output = output.undenormal();
+      i2 = i1; i1 = input;
+      o2 = o1; o1 = output;
+      return output;
+    }
+    void mute(){ i1 = i2 = o1 = o2 = vec4<_fv3_float_t>(); }
+  };
+  loopfilter lsfv[FV3_ZREV2_MAX_VECTORS], hsfv[FV3_ZREV2_MAX_VECTORS];
+
+  // The io of processreplace(), separate input and output buffers.
+  struct bufferio
+  {
+    _fv3_float_t *inputL, *inputR, *outputL, *outputR;
+    inline void read(_fv3_float_t& l, _fv3_float_t& r){ l = *inputL++; r = *inputR++; }
+    inline void write(const _fv3_float_t * outputs){ *outputL++ = outputs[0]; *outputR++ = outputs[1]; }
+  };
 };
@@ -33,9 +33,9 @@ public:
   _fv3_float_t getapfeedback();
   virtual void setloopdamp(_fv3_float_t value);
   _fv3_float_t getloopdamp();
-  void setoutputlpf(_fv3_float_t value);
+  virtual void setoutputlpf(_fv3_float_t value);
   _fv3_float_t getoutputlpf() const;
-  void setoutputhpf(_fv3_float_t value);
+  virtual void setoutputhpf(_fv3_float_t value);
   _fv3_float_t getoutputhpf() const;
   void setdccutfreq(_fv3_float_t value);
   _fv3_float_t getdccutfreq();
@@ -51,10 +51,15 @@ public:
   _FV3_(zrev)(const _FV3_(zrev)& x);
   _FV3_(zrev)& operator=(const _FV3_(zrev)& x);
   virtual void setFsFactors();
+  virtual void setbuffers();
 
   _fv3_float_t rt60, apfeedback, loopdamp, outputlpf, outputhpf, dccutfq;
-  _FV3_(allpassm) _diff1[FV3_ZREV_NUM_DELAYS];
-  _FV3_(delaym) _delay[FV3_ZREV_NUM_DELAYS];
+  // The zrev algorithm uses FV3_ZREV_NUM_DELAYS lines, derived classes may
+  // use up to FV3_ZREV_MAX_DELAYS lines with their own lengths (in s).
+  long numdelays;
+  const _fv3_float_t *lengthReal, *lengthDiff;
+  _FV3_(allpassm) _diff1[FV3_ZREV_MAX_DELAYS];
+  _FV3_(delaym) _delay[FV3_ZREV_MAX_DELAYS];
   _FV3_(dccut) dccutL, dccutR;
   _FV3_(iir_1st) _filt1[FV3_ZREV_NUM_DELAYS], out1_lpf, out2_lpf, out1_hpf, out2_hpf;
   _fv3_float_t  lfo1freq, lfo2freq, lfofactor;
@@ -0,0 +1,531 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioFile.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+// WAV and AIFF chunk sizes are 32 bit
+constexpr std::uint64_t maxChunkSize = 0xffffffffu;
+
+bool seekTo(std::FILE* file, std::uint64_t position)
+{
+#if defined(_WIN32)
+    return _fseeki64(file, static_cast<__int64>(position), SEEK_SET) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(position), SEEK_SET) == 0;
+#endif
+}
+
+std::uint64_t getPosition(std::FILE* file)
+{
+#if defined(_WIN32)
+    return static_cast<std::uint64_t>(_ftelli64(file));
+#else
+    return static_cast<std::uint64_t>(ftello(file));
+#endif
+}
+
+int getBytesPerSample(AudioSampleType sampleType)
+{
+    switch (sampleType)
+    {
+    case AudioSampleType::int16:
+        return 2;
+    case AudioSampleType::int24:
+        return 3;
+    case AudioSampleType::int32:
+    case AudioSampleType::float32:
+        return 4;
+    case AudioSampleType::float64:
+        return 8;
+    }
+    return 0;
+}
+
+std::uint32_t getUInt(const unsigned char* bytes, int numBytes, bool bigEndian)
+{
+    std::uint32_t value = 0;
+    for (int i = 0; i < numBytes; ++i)
+        value |= static_cast<std::uint32_t>(bytes[bigEndian ? numBytes - 1 - i : i]) << (8 * i);
+    return value;
+}
+
+void putUInt(unsigned char* bytes, std::uint32_t value, int numBytes, bool bigEndian)
+{
+    for (int i = 0; i < numBytes; ++i)
+        bytes[bigEndian ? numBytes - 1 - i : i] = static_cast<unsigned char>(value >> (8 * i));
+}
+
+float decodeSample(const unsigned char* bytes, AudioSampleType sampleType, bool bigEndian)
+{
+    switch (sampleType)
+    {
+    case AudioSampleType::int16:
+        return static_cast<float>(static_cast<std::int16_t>(getUInt(bytes, 2, bigEndian))) / 32768.0f;
+    case AudioSampleType::int24:
+        // the sign is extended by shifting the 24 bits to the top of an int32
+        return static_cast<float>(static_cast<std::int32_t>(getUInt(bytes, 3, bigEndian) << 8) / 256) / 8388608.0f;
+    case AudioSampleType::int32:
+        return static_cast<float>(static_cast<double>(static_cast<std::int32_t>(getUInt(bytes, 4, bigEndian))) / 2147483648.0);
+    case AudioSampleType::float32:
+    {
+        const std::uint32_t bits = getUInt(bytes, 4, bigEndian);
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    case AudioSampleType::float64:
+    {
+        const std::uint64_t bits = getUInt(bytes, 4, bigEndian) |
+                                   static_cast<std::uint64_t>(getUInt(bytes + 4, 4, bigEndian)) << 32;
+        const std::uint64_t ordered = bigEndian ? (bits >> 32 | bits << 32) : bits;
+        double value;
+        std::memcpy(&value, &ordered, sizeof(value));
+        return static_cast<float>(value);
+    }
+    }
+    return 0.0f;
+}
+
+// integer samples are scaled by the same factor as in decodeSample(), so they are written back unchanged
+std::uint32_t encodeInteger(float value, double scale)
+{
+    double scaled = std::floor(static_cast<double>(value) * scale + 0.5);
+    if (std::isnan(scaled))
+        scaled = 0.0;
+    scaled = scaled < -scale ? -scale : (scaled > scale - 1.0 ? scale - 1.0 : scaled);
+    return static_cast<std::uint32_t>(static_cast<std::int64_t>(scaled));
+}
+
+void encodeSample(unsigned char* bytes, float value, AudioSampleType sampleType, bool bigEndian)
+{
+    switch (sampleType)
+    {
+    case AudioSampleType::int16:
+        putUInt(bytes, encodeInteger(value, 32768.0), 2, bigEndian);
+        break;
+    case AudioSampleType::int24:
+        putUInt(bytes, encodeInteger(value, 8388608.0), 3, bigEndian);
+        break;
+    case AudioSampleType::int32:
+        putUInt(bytes, encodeInteger(value, 2147483648.0), 4, bigEndian);
+        break;
+    case AudioSampleType::float32:
+    {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putUInt(bytes, bits, 4, bigEndian);
+        break;
+    }
+    case AudioSampleType::float64:
+    {
+        const double wide = value;
+        std::uint64_t bits;
+        std::memcpy(&bits, &wide, sizeof(bits));
+        putUInt(bytes + (bigEndian ? 4 : 0), static_cast<std::uint32_t>(bits), 4, bigEndian);
+        putUInt(bytes + (bigEndian ? 0 : 4), static_cast<std::uint32_t>(bits >> 32), 4, bigEndian);
+        break;
+    }
+    }
+}
+
+// AIFF stores the sample rate as an 80 bit IEEE 754 extended precision number
+double decodeExtended(const unsigned char* bytes)
+{
+    const int exponent = static_cast<int>(getUInt(bytes, 2, true) & 0x7fff);
+    const std::uint64_t mantissa = static_cast<std::uint64_t>(getUInt(bytes + 2, 4, true)) << 32 | getUInt(bytes + 6, 4, true);
+    if (exponent == 0 && mantissa == 0)
+        return 0.0;
+    const double value = std::ldexp(static_cast<double>(mantissa), exponent - 16383 - 63);
+    return (bytes[0] & 0x80) ? -value : value;
+}
+
+void encodeExtended(unsigned char* bytes, double value)
+{
+    std::memset(bytes, 0, 10);
+    if (value <= 0.0)
+        return;
+    int exponent;
+    const double fraction = std::frexp(value, &exponent); // value = fraction * 2^exponent, 0.5 <= fraction < 1
+    const std::uint64_t mantissa = static_cast<std::uint64_t>(std::ldexp(fraction, 64));
+    putUInt(bytes, static_cast<std::uint32_t>(exponent - 1 + 16383), 2, true);
+    putUInt(bytes + 2, static_cast<std::uint32_t>(mantissa >> 32), 4, true);
+    putUInt(bytes + 6, static_cast<std::uint32_t>(mantissa), 4, true);
+}
+
+bool readBytes(std::FILE* file, unsigned char* bytes, std::size_t numBytes)
+{
+    return std::fread(bytes, 1, numBytes, file) == numBytes;
+}
+} // namespace
+
+//==============================================================================
+AudioFileReader::~AudioFileReader()
+{
+    close();
+}
+
+bool AudioFileReader::open(const std::string& path)
+{
+    close();
+    error.clear();
+    file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return fail("can't open the file");
+
+    unsigned char header[12];
+    if (!readBytes(file, header, sizeof(header)))
+        return fail("the file is too short");
+
+    bool headerRead = false;
+    if (std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WAVE", 4) == 0)
+        headerRead = readWavHeader();
+    else if (std::memcmp(header, "FORM", 4) == 0 && std::memcmp(header + 8, "AIFF", 4) == 0)
+        headerRead = readAiffHeader(false);
+    else if (std::memcmp(header, "FORM", 4) == 0 && std::memcmp(header + 8, "AIFC", 4) == 0)
+        headerRead = readAiffHeader(true);
+    else
+        return fail("not a WAV or AIFF file");
+    if (!headerRead)
+        return false;
+
+    if (numChannels <= 0 || sampleRate <= 0.0)
+        return fail("invalid channel count or sample rate");
+    framesLeft = numFrames;
+    return true;
+}
+
+bool AudioFileReader::readWavHeader()
+{
+    format = AudioFileFormat::wav;
+    bigEndian = false;
+
+    // the chunks may be in any order, the position of the sample data is remembered until the format is known
+    bool formatFound = false;
+    std::uint64_t dataPosition = 0;
+    std::uint64_t dataSize = 0;
+    bool dataFound = false;
+    int bytesPerFrame = 0;
+    unsigned char chunkHeader[8];
+    while (readBytes(file, chunkHeader, sizeof(chunkHeader)))
+    {
+        const std::uint32_t chunkSize = getUInt(chunkHeader + 4, 4, false);
+        const std::uint64_t chunkStart = getPosition(file);
+        if (std::memcmp(chunkHeader, "fmt ", 4) == 0)
+        {
+            unsigned char chunk[40] = {};
+            if (chunkSize < 16 || !readBytes(file, chunk, chunkSize < sizeof(chunk) ? chunkSize : sizeof(chunk)))
+                return fail("invalid fmt chunk");
+            std::uint32_t formatTag = getUInt(chunk, 2, false);
+            numChannels = static_cast<int>(getUInt(chunk + 2, 2, false));
+            sampleRate = static_cast<double>(getUInt(chunk + 4, 4, false));
+            bytesPerFrame = static_cast<int>(getUInt(chunk + 12, 2, false));
+            const std::uint32_t bitsPerSample = getUInt(chunk + 14, 2, false);
+            // WAVE_FORMAT_EXTENSIBLE keeps the actual format tag in the first two bytes of the sub format GUID
+            if (formatTag == 0xfffe && chunkSize >= 40)
+                formatTag = getUInt(chunk + 24, 2, false);
+
+            if (formatTag == 1 && bitsPerSample == 16)
+                sampleType = AudioSampleType::int16;
+            else if (formatTag == 1 && bitsPerSample == 24)
+                sampleType = AudioSampleType::int24;
+            else if (formatTag == 1 && bitsPerSample == 32)
+                sampleType = AudioSampleType::int32;
+            else if (formatTag == 3 && bitsPerSample == 32)
+                sampleType = AudioSampleType::float32;
+            else if (formatTag == 3 && bitsPerSample == 64)
+                sampleType = AudioSampleType::float64;
+            else
+                return fail("unsupported sample format (16, 24, 32 bit PCM and 32, 64 bit float are supported)");
+            formatFound = true;
+        }
+        else if (std::memcmp(chunkHeader, "data", 4) == 0)
+        {
+            dataPosition = chunkStart;
+            dataSize = chunkSize;
+            dataFound = true;
+        }
+        if (formatFound && dataFound)
+            break;
+        // chunks are padded to an even size
+        if (!seekTo(file, chunkStart + chunkSize + (chunkSize & 1)))
+            break;
+    }
+
+    if (!formatFound || !dataFound)
+        return fail("missing fmt or data chunk");
+    if (bytesPerFrame != numChannels * getBytesPerSample(sampleType))
+        return fail("invalid block align");
+    numFrames = dataSize / static_cast<std::uint64_t>(bytesPerFrame);
+    if (!seekTo(file, dataPosition))
+        return fail("can't seek to the sample data");
+    return true;
+}
+
+bool AudioFileReader::readAiffHeader(bool isAifc)
+{
+    format = AudioFileFormat::aiff;
+    bigEndian = true;
+
+    bool commonFound = false;
+    std::uint64_t dataPosition = 0;
+    bool dataFound = false;
+    unsigned char chunkHeader[8];
+    while (readBytes(file, chunkHeader, sizeof(chunkHeader)))
+    {
+        const std::uint32_t chunkSize = getUInt(chunkHeader + 4, 4, true);
+        const std::uint64_t chunkStart = getPosition(file);
+        if (std::memcmp(chunkHeader, "COMM", 4) == 0)
+        {
+            unsigned char chunk[22] = {};
+            if (chunkSize < (isAifc ? 22u : 18u) || !readBytes(file, chunk, isAifc ? 22 : 18))
+                return fail("invalid COMM chunk");
+            numChannels = static_cast<int>(getUInt(chunk, 2, true));
+            numFrames = getUInt(chunk + 2, 4, true);
+            const std::uint32_t bitsPerSample = getUInt(chunk + 6, 2, true);
+            sampleRate = decodeExtended(chunk + 8);
+
+            // AIFF-C adds the compression type, only uncompressed and float data is supported
+            bool isFloat = false;
+            if (isAifc)
+            {
+                if (std::memcmp(chunk + 18, "sowt", 4) == 0)
+                    bigEndian = false;
+                else if (std::memcmp(chunk + 18, "fl32", 4) == 0 || std::memcmp(chunk + 18, "FL32", 4) == 0 ||
+                         std::memcmp(chunk + 18, "fl64", 4) == 0 || std::memcmp(chunk + 18, "FL64", 4) == 0)
+                    isFloat = true;
+                else if (std::memcmp(chunk + 18, "NONE", 4) != 0)
+                    return fail("unsupported AIFF-C compression");
+            }
+
+            if (!isFloat && bitsPerSample == 16)
+                sampleType = AudioSampleType::int16;
+            else if (!isFloat && bitsPerSample == 24)
+                sampleType = AudioSampleType::int24;
+            else if (!isFloat && bitsPerSample == 32)
+                sampleType = AudioSampleType::int32;
+            else if (isFloat && (chunk[21] == '2' || bitsPerSample == 32))
+                sampleType = AudioSampleType::float32;
+            else if (isFloat)
+                sampleType = AudioSampleType::float64;
+            else
+                return fail("unsupported sample format (16, 24, 32 bit PCM and 32, 64 bit float are supported)");
+            commonFound = true;
+        }
+        else if (std::memcmp(chunkHeader, "SSND", 4) == 0)
+        {
+            unsigned char chunk[8];
+            if (chunkSize < 8 || !readBytes(file, chunk, sizeof(chunk)))
+                return fail("invalid SSND chunk");
+            dataPosition = chunkStart + 8 + getUInt(chunk, 4, true);
+            dataFound = true;
+        }
+        if (commonFound && dataFound)
+            break;
+        if (!seekTo(file, chunkStart + chunkSize + (chunkSize & 1)))
+            break;
+    }
+
+    if (!commonFound || !dataFound)
+        return fail("missing COMM or SSND chunk");
+    if (!seekTo(file, dataPosition))
+        return fail("can't seek to the sample data");
+    return true;
+}
+
+void AudioFileReader::close()
+{
+    if (file != nullptr)
+        std::fclose(file);
+    file = nullptr;
+    numFrames = 0;
+    framesLeft = 0;
+}
+
+int AudioFileReader::read(float* const* channels, int numFramesToRead)
+{
+    if (file == nullptr || numFramesToRead <= 0 || framesLeft == 0)
+        return 0;
+    if (static_cast<std::uint64_t>(numFramesToRead) > framesLeft)
+        numFramesToRead = static_cast<int>(framesLeft);
+
+    const int bytesPerSample = getBytesPerSample(sampleType);
+    const std::size_t bytesPerFrame = static_cast<std::size_t>(bytesPerSample * numChannels);
+    rawBuffer.resize(bytesPerFrame * static_cast<std::size_t>(numFramesToRead));
+    const int numFramesRead = static_cast<int>(std::fread(rawBuffer.data(), bytesPerFrame, static_cast<std::size_t>(numFramesToRead), file));
+    // a truncated file ends early instead of failing
+    framesLeft = numFramesRead < numFramesToRead ? 0 : framesLeft - static_cast<std::uint64_t>(numFramesRead);
+
+    const unsigned char* bytes = rawBuffer.data();
+    for (int frame = 0; frame < numFramesRead; ++frame)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            channels[channel][frame] = decodeSample(bytes, sampleType, bigEndian);
+            bytes += bytesPerSample;
+        }
+    }
+    return numFramesRead;
+}
+
+bool AudioFileReader::fail(const std::string& message)
+{
+    error = message;
+    close();
+    return false;
+}
+
+//==============================================================================
+AudioFileWriter::~AudioFileWriter()
+{
+    close();
+}
+
+bool AudioFileWriter::open(const std::string& path, AudioFileFormat newFormat, AudioSampleType newSampleType,
+                           int newNumChannels, double newSampleRate)
+{
+    close();
+    error.clear();
+    if (newFormat == AudioFileFormat::aiff &&
+        (newSampleType == AudioSampleType::float32 || newSampleType == AudioSampleType::float64))
+        return fail("AIFF files only support integer samples");
+    if (newNumChannels <= 0 || newSampleRate <= 0.0)
+        return fail("invalid channel count or sample rate");
+
+    format = newFormat;
+    sampleType = newSampleType;
+    numChannels = newNumChannels;
+    sampleRate = newSampleRate;
+    numFrames = 0;
+
+    file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr)
+        return fail("can't create the file");
+    // the header is written again with the final sizes when the file is closed
+    return writeHeader();
+}
+
+bool AudioFileWriter::writeHeader()
+{
+    const std::uint32_t bytesPerSample = static_cast<std::uint32_t>(getBytesPerSample(sampleType));
+    const std::uint32_t bytesPerFrame = bytesPerSample * static_cast<std::uint32_t>(numChannels);
+    const std::uint32_t dataSize = static_cast<std::uint32_t>(numFrames * bytesPerFrame);
+    unsigned char header[54] = {};
+    std::size_t headerSize;
+
+    if (format == AudioFileFormat::wav)
+    {
+        const bool isFloat = sampleType == AudioSampleType::float32 || sampleType == AudioSampleType::float64;
+        std::memcpy(header, "RIFF", 4);
+        putUInt(header + 4, 36 + dataSize + (dataSize & 1), 4, false);
+        std::memcpy(header + 8, "WAVEfmt ", 8);
+        putUInt(header + 16, 16, 4, false);
+        putUInt(header + 20, isFloat ? 3 : 1, 2, false);
+        putUInt(header + 22, static_cast<std::uint32_t>(numChannels), 2, false);
+        putUInt(header + 24, static_cast<std::uint32_t>(sampleRate), 4, false);
+        putUInt(header + 28, static_cast<std::uint32_t>(sampleRate) * bytesPerFrame, 4, false);
+        putUInt(header + 32, bytesPerFrame, 2, false);
+        putUInt(header + 34, bytesPerSample * 8, 2, false);
+        std::memcpy(header + 36, "data", 4);
+        putUInt(header + 40, dataSize, 4, false);
+        headerSize = 44;
+    }
+    else
+    {
+        std::memcpy(header, "FORM", 4);
+        putUInt(header + 4, 46 + dataSize + (dataSize & 1), 4, true);
+        std::memcpy(header + 8, "AIFFCOMM", 8);
+        putUInt(header + 16, 18, 4, true);
+        putUInt(header + 20, static_cast<std::uint32_t>(numChannels), 2, true);
+        putUInt(header + 22, static_cast<std::uint32_t>(numFrames), 4, true);
+        putUInt(header + 26, bytesPerSample * 8, 2, true);
+        encodeExtended(header + 28, sampleRate);
+        std::memcpy(header + 38, "SSND", 4);
+        putUInt(header + 42, 8 + dataSize, 4, true);
+        // offset and block size are 0
+        headerSize = 54;
+    }
+
+    if (!seekTo(file, 0) || std::fwrite(header, 1, headerSize, file) != headerSize)
+        return fail("can't write the header");
+    return true;
+}
+
+bool AudioFileWriter::write(const float* const* channels, int numFramesToWrite)
+{
+    if (file == nullptr)
+        return false;
+    if (numFramesToWrite <= 0)
+        return true;
+
+    const int bytesPerSample = getBytesPerSample(sampleType);
+    const std::size_t bytesPerFrame = static_cast<std::size_t>(bytesPerSample * numChannels);
+    if ((numFrames + static_cast<std::uint64_t>(numFramesToWrite)) * bytesPerFrame > maxChunkSize - 64)
+        return fail("the file would exceed the 4 GB size limit");
+
+    const bool bigEndian = format == AudioFileFormat::aiff;
+    rawBuffer.resize(bytesPerFrame * static_cast<std::size_t>(numFramesToWrite));
+    unsigned char* bytes = rawBuffer.data();
+    for (int frame = 0; frame < numFramesToWrite; ++frame)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            encodeSample(bytes, channels[channel][frame], sampleType, bigEndian);
+            bytes += bytesPerSample;
+        }
+    }
+
+    if (std::fwrite(rawBuffer.data(), 1, rawBuffer.size(), file) != rawBuffer.size())
+        return fail("can't write the sample data");
+    numFrames += static_cast<std::uint64_t>(numFramesToWrite);
+    return true;
+}
+
+bool AudioFileWriter::close()
+{
+    if (file == nullptr)
+        return error.empty();
+
+    // the sample data is padded to an even size
+    const std::uint64_t dataSize = numFrames * static_cast<std::uint64_t>(getBytesPerSample(sampleType) * numChannels);
+    bool success = true;
+    if (dataSize & 1)
+        success = std::fputc(0, file) != EOF;
+    success = success && writeHeader();
+    if (file != nullptr)
+    {
+        success = std::fclose(file) == 0 && success;
+        file = nullptr;
+    }
+    if (!success && error.empty())
+        error = "can't finish the file";
+    return success;
+}
+
+bool AudioFileWriter::fail(const std::string& message)
+{
+    error = message;
+    if (file != nullptr)
+        std::fclose(file);
+    file = nullptr;
+    return false;
+}
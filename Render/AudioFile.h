@@ -0,0 +1,114 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Streaming readers and writers for uncompressed WAV and AIFF files. Only one block of samples is held in memory, so
+// files of any length can be processed. All functions return false on errors and getError() describes the problem.
+
+enum class AudioFileFormat
+{
+    wav,
+    aiff
+};
+
+enum class AudioSampleType
+{
+    int16,
+    int24,
+    int32,
+    float32,
+    float64
+};
+
+class AudioFileReader
+{
+public:
+    AudioFileReader() = default;
+    ~AudioFileReader();
+    AudioFileReader(const AudioFileReader&) = delete;
+    AudioFileReader& operator=(const AudioFileReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+
+    // reads up to numFrames frames into one buffer per channel and returns the number of frames read, 0 at the end
+    // of the file or on errors
+    int read(float* const* channels, int numFrames);
+
+    AudioFileFormat getFormat() const { return format; }
+    AudioSampleType getSampleType() const { return sampleType; }
+    int getNumChannels() const { return numChannels; }
+    double getSampleRate() const { return sampleRate; }
+    std::uint64_t getNumFrames() const { return numFrames; }
+    const std::string& getError() const { return error; }
+
+private:
+    bool readWavHeader();
+    bool readAiffHeader(bool isAifc);
+    bool fail(const std::string& message);
+
+    std::FILE* file = nullptr;
+    AudioFileFormat format = AudioFileFormat::wav;
+    AudioSampleType sampleType = AudioSampleType::int16;
+    bool bigEndian = false;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    std::uint64_t numFrames = 0;
+    std::uint64_t framesLeft = 0;
+    std::vector<unsigned char> rawBuffer;
+    std::string error;
+};
+
+class AudioFileWriter
+{
+public:
+    AudioFileWriter() = default;
+    ~AudioFileWriter();
+    AudioFileWriter(const AudioFileWriter&) = delete;
+    AudioFileWriter& operator=(const AudioFileWriter&) = delete;
+
+    // AIFF files only support integer samples
+    bool open(const std::string& path, AudioFileFormat newFormat, AudioSampleType newSampleType, int newNumChannels,
+              double newSampleRate);
+    // writes numFrames frames from one buffer per channel, integer samples are clipped to -1 ... 1
+    bool write(const float* const* channels, int numFrames);
+    // writes the final chunk sizes into the header
+    bool close();
+
+    const std::string& getError() const { return error; }
+
+private:
+    bool writeHeader();
+    bool fail(const std::string& message);
+
+    std::FILE* file = nullptr;
+    AudioFileFormat format = AudioFileFormat::wav;
+    AudioSampleType sampleType = AudioSampleType::int16;
+    int numChannels = 0;
+    double sampleRate = 0.0;
+    std::uint64_t numFrames = 0;
+    std::vector<unsigned char> rawBuffer;
+    std::string error;
+};
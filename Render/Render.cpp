@@ -0,0 +1,447 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "AudioFile.h"
+#include "HallReverb.h"
+#include "WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+struct Options
+{
+    std::vector<std::string> inputPaths;
+    std::string outputPath;
+    // batch mode renders all inputs into this directory
+    std::string batchDirectory;
+    int numThreads = 0; // 0 = one per CPU
+    bool pinThreads = true;
+    // parameters in the order they were given, later values override earlier ones
+    std::vector<std::pair<HallReverb::Parameter, float>> parameters;
+    int blockSize = 8192;
+    bool appendTail = true;
+    double tailThreshold = -90.0; // dBFS
+    double maxTailSeconds = 60.0;
+    int numLateDelays = 8;
+    bool downsampleLate = false;
+    bool sampleTypeGiven = false;
+    AudioSampleType sampleType = AudioSampleType::int24;
+};
+
+struct RenderResult
+{
+    std::uint64_t numInputFrames = 0;
+    std::uint64_t numTailFrames = 0;
+    double sampleRate = 0.0;
+};
+
+// the tail ends when the output stayed below the threshold for this long, which is longer than the predelay
+constexpr double tailHoldSeconds = 0.5;
+
+void printUsage(const char* name)
+{
+    std::printf("usage: %s [options] <input> <output>\n", name);
+    std::printf("       %s [options] --batch <output directory> <input>...\n", name);
+    std::printf("Renders a WAV or AIFF file (mono or stereo) through the Hall Reverb into a stereo file.\n");
+    std::printf("The output format is chosen by the extension of the output file (.aif/.aiff or .wav).\n");
+    std::printf("  --preset <file>        load parameters from a preset file with one \"<parameter> = <value>\" per line\n");
+    std::printf("  --<parameter> <value>  set a parameter, e.g. --lateDecay 2.5 (later options override earlier ones)\n");
+    std::printf("  --format <type>        output sample format: int16, int24, int32, float32 or float64\n");
+    std::printf("                         (default: the input format, int24 for float input in AIFF files)\n");
+    std::printf("  --block <samples>      processing block size (default: 8192)\n");
+    std::printf("  --threshold <dB>       the tail ends when the output stays below this level (default: -90)\n");
+    std::printf("  --max-tail <s>         maximum length of the tail (default: 60)\n");
+    std::printf("  --no-tail              don't append the reverb tail\n");
+    std::printf("  --delays <n>           number of delay lines of the late reverb: 4, 8, 16 or 32 (default: 8)\n");
+    std::printf("  --downsample           run the late reverb at 44.1 or 48 kHz if the file has a higher sample rate\n");
+    std::printf("  --batch <directory>    render all inputs in parallel into the directory, keeping their file names\n");
+    std::printf("  --threads <n>          number of threads in batch mode (default: one per CPU)\n");
+    std::printf("  --no-pin               don't pin the batch threads to CPUs\n");
+    std::printf("parameters:");
+    for (int i = 0; i < static_cast<int>(HallReverb::Parameter::numParameters); ++i)
+        std::printf("%s %s", i % 6 == 0 ? "\n " : "", HallReverb::getParameterName(static_cast<HallReverb::Parameter>(i)));
+    std::printf("\n");
+}
+
+bool findParameter(const std::string& name, HallReverb::Parameter& parameter)
+{
+    for (int i = 0; i < static_cast<int>(HallReverb::Parameter::numParameters); ++i)
+    {
+        if (name == HallReverb::getParameterName(static_cast<HallReverb::Parameter>(i)))
+        {
+            parameter = static_cast<HallReverb::Parameter>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseNumber(const std::string& text, double& value)
+{
+    char* end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return !text.empty() && end != nullptr && *end == '\0' && std::isfinite(value);
+}
+
+bool loadPreset(const std::string& path, Options& options)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::fprintf(stderr, "error: can't open preset %s\n", path.c_str());
+        return false;
+    }
+
+    // "<parameter> = <value>" per line, empty lines and everything after a # are ignored
+    std::string line;
+    for (int lineNumber = 1; std::getline(file, line); ++lineNumber)
+    {
+        const auto comment = line.find('#');
+        if (comment != std::string::npos)
+            line.erase(comment);
+        for (auto& c : line)
+            if (c == '=' || c == '\t' || c == '\r')
+                c = ' ';
+
+        std::istringstream fields(line);
+        std::string name, valueText, rest;
+        if (!(fields >> name))
+            continue;
+        HallReverb::Parameter parameter;
+        double value;
+        if (!findParameter(name, parameter) || !(fields >> valueText) || !parseNumber(valueText, value) || (fields >> rest))
+        {
+            std::fprintf(stderr, "error: %s:%d: expected \"<parameter> = <value>\"\n", path.c_str(), lineNumber);
+            return false;
+        }
+        options.parameters.emplace_back(parameter, static_cast<float>(value));
+    }
+    return true;
+}
+
+bool parseSampleType(const std::string& text, AudioSampleType& sampleType)
+{
+    const std::pair<const char*, AudioSampleType> types[] = {
+        {"int16", AudioSampleType::int16},
+        {"int24", AudioSampleType::int24},
+        {"int32", AudioSampleType::int32},
+        {"float32", AudioSampleType::float32},
+        {"float64", AudioSampleType::float64},
+    };
+    for (const auto& type : types)
+    {
+        if (text == type.first)
+        {
+            sampleType = type.second;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string option = argv[i];
+        const bool hasValue = i + 1 < argc;
+        double value = 0.0;
+        HallReverb::Parameter parameter;
+
+        if (option == "--preset" && hasValue)
+        {
+            if (!loadPreset(argv[++i], options))
+                return false;
+        }
+        else if (option == "--format" && hasValue)
+        {
+            if (!parseSampleType(argv[++i], options.sampleType))
+                return false;
+            options.sampleTypeGiven = true;
+        }
+        else if (option == "--block" && hasValue && parseNumber(argv[++i], value))
+            options.blockSize = static_cast<int>(value);
+        else if (option == "--threshold" && hasValue && parseNumber(argv[++i], value))
+            options.tailThreshold = value;
+        else if (option == "--max-tail" && hasValue && parseNumber(argv[++i], value))
+            options.maxTailSeconds = value;
+        else if (option == "--no-tail")
+            options.appendTail = false;
+        else if (option == "--delays" && hasValue && parseNumber(argv[++i], value) &&
+                 (value == 4.0 || value == 8.0 || value == 16.0 || value == 32.0))
+            options.numLateDelays = static_cast<int>(value);
+        else if (option == "--downsample")
+            options.downsampleLate = true;
+        else if (option == "--batch" && hasValue)
+            options.batchDirectory = argv[++i];
+        else if (option == "--threads" && hasValue && parseNumber(argv[++i], value))
+            options.numThreads = static_cast<int>(value);
+        else if (option == "--no-pin")
+            options.pinThreads = false;
+        else if (option.compare(0, 2, "--") == 0 && findParameter(option.substr(2), parameter) && hasValue &&
+                 parseNumber(argv[++i], value))
+            options.parameters.emplace_back(parameter, static_cast<float>(value));
+        else if (option.compare(0, 2, "--") != 0)
+            paths.push_back(option);
+        else
+            return false;
+    }
+
+    // batch mode takes any number of inputs, otherwise an input and an output
+    if (options.batchDirectory.empty())
+    {
+        if (paths.size() != 2)
+            return false;
+        options.outputPath = paths.back();
+        paths.pop_back();
+    }
+    else if (paths.empty())
+        return false;
+    options.inputPaths = paths;
+    return options.blockSize > 0 && options.maxTailSeconds >= 0.0;
+}
+
+AudioFileFormat getFormatFromExtension(const std::string& path)
+{
+    const auto dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot + 1);
+    for (auto& c : extension)
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return extension == "aif" || extension == "aiff" ? AudioFileFormat::aiff : AudioFileFormat::wav;
+}
+
+float getPeak(const float* samples, int numSamples)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numSamples; ++i)
+        peak = std::fabs(samples[i]) > peak ? std::fabs(samples[i]) : peak;
+    return peak;
+}
+
+// renders one file, this is called from several threads in batch mode
+bool renderFile(const Options& options, const std::string& inputPath, const std::string& outputPath,
+                RenderResult& result, std::string& error)
+{
+    AudioFileReader reader;
+    if (!reader.open(inputPath))
+    {
+        error = inputPath + ": " + reader.getError();
+        return false;
+    }
+    if (reader.getNumChannels() > 2)
+    {
+        error = inputPath + ": only mono and stereo files are supported";
+        return false;
+    }
+
+    const AudioFileFormat outputFormat = getFormatFromExtension(outputPath);
+    AudioSampleType outputSampleType = options.sampleTypeGiven ? options.sampleType : reader.getSampleType();
+    if (!options.sampleTypeGiven && outputFormat == AudioFileFormat::aiff &&
+        (outputSampleType == AudioSampleType::float32 || outputSampleType == AudioSampleType::float64))
+        outputSampleType = AudioSampleType::int24;
+
+    AudioFileWriter writer;
+    if (!writer.open(outputPath, outputFormat, outputSampleType, 2, reader.getSampleRate()))
+    {
+        error = outputPath + ": " + writer.getError();
+        return false;
+    }
+
+    // the parameters are set before the sample rate, so they are applied without a ramp
+    auto reverb = std::make_unique<HallReverb>();
+    for (const auto& parameter : options.parameters)
+        reverb->setParameter(parameter.first, parameter.second);
+    const double sampleRate = reader.getSampleRate();
+    result.sampleRate = sampleRate;
+    reverb->setLateDownsampling(options.downsampleLate);
+    reverb->setSampleRate(static_cast<float>(sampleRate));
+    reverb->setMonoInput(reader.getNumChannels() == 1);
+    reverb->setNumLateDelays(options.numLateDelays);
+
+    const int blockSize = options.blockSize;
+    std::vector<float> leftIn(blockSize), rightIn(blockSize), leftOut(blockSize), rightOut(blockSize);
+    float* inputChannels[] = {leftIn.data(), rightIn.data()};
+    const float* outputChannels[] = {leftOut.data(), rightOut.data()};
+
+    // the input is streamed through the reverb block by block, a mono input feeds both reverb inputs
+    int numFrames;
+    while ((numFrames = reader.read(inputChannels, blockSize)) > 0)
+    {
+        const float* rightInput = reader.getNumChannels() == 1 ? leftIn.data() : rightIn.data();
+        reverb->process(leftIn.data(), rightInput, leftOut.data(), rightOut.data(), numFrames);
+        if (!writer.write(outputChannels, numFrames))
+        {
+            error = outputPath + ": " + writer.getError();
+            return false;
+        }
+        result.numInputFrames += static_cast<std::uint64_t>(numFrames);
+    }
+
+    // The tail is rendered with silent input until the output stayed below the threshold for tailHoldSeconds. Quiet
+    // blocks are held back until the output gets louder again, so the file ends with the last sample above the
+    // threshold rounded up to the block size.
+    if (options.appendTail)
+    {
+        const float threshold = static_cast<float>(std::pow(10.0, options.tailThreshold / 20.0));
+        const auto maxTailFrames = static_cast<std::uint64_t>(options.maxTailSeconds * sampleRate);
+        const auto holdFrames = static_cast<std::uint64_t>(tailHoldSeconds * sampleRate);
+        std::vector<float> heldLeft, heldRight;
+        std::fill(leftIn.begin(), leftIn.end(), 0.0f);
+        std::fill(rightIn.begin(), rightIn.end(), 0.0f);
+
+        std::uint64_t numRenderedFrames = 0;
+        while (numRenderedFrames < maxTailFrames && heldLeft.size() < holdFrames)
+        {
+            numFrames = static_cast<int>(std::min<std::uint64_t>(static_cast<std::uint64_t>(blockSize), maxTailFrames - numRenderedFrames));
+            reverb->process(leftIn.data(), rightIn.data(), leftOut.data(), rightOut.data(), numFrames);
+            numRenderedFrames += static_cast<std::uint64_t>(numFrames);
+
+            if (getPeak(leftOut.data(), numFrames) < threshold && getPeak(rightOut.data(), numFrames) < threshold)
+            {
+                heldLeft.insert(heldLeft.end(), leftOut.begin(), leftOut.begin() + numFrames);
+                heldRight.insert(heldRight.end(), rightOut.begin(), rightOut.begin() + numFrames);
+                continue;
+            }
+
+            const float* heldChannels[] = {heldLeft.data(), heldRight.data()};
+            if (!writer.write(heldChannels, static_cast<int>(heldLeft.size())) || !writer.write(outputChannels, numFrames))
+            {
+                error = outputPath + ": " + writer.getError();
+                return false;
+            }
+            result.numTailFrames += heldLeft.size() + static_cast<std::uint64_t>(numFrames);
+            heldLeft.clear();
+            heldRight.clear();
+        }
+    }
+
+    if (!writer.close())
+    {
+        error = outputPath + ": " + writer.getError();
+        return false;
+    }
+
+    return true;
+}
+
+void printResult(const std::string& outputPath, const RenderResult& result, double elapsedSeconds)
+{
+    const double audioSeconds = static_cast<double>(result.numInputFrames + result.numTailFrames) / result.sampleRate;
+    std::printf("%s: %.2f s input + %.2f s tail rendered in %.2f s (%.1fx realtime)\n", outputPath.c_str(),
+                static_cast<double>(result.numInputFrames) / result.sampleRate,
+                static_cast<double>(result.numTailFrames) / result.sampleRate, elapsedSeconds,
+                elapsedSeconds > 0.0 ? audioSeconds / elapsedSeconds : 0.0);
+}
+
+std::string getFileName(const std::string& path)
+{
+    const auto separator = path.find_last_of("/\\");
+    return separator == std::string::npos ? path : path.substr(separator + 1);
+}
+
+int renderBatch(const Options& options)
+{
+    // the outputs keep the file names of the inputs, so two inputs with the same name would overwrite each other
+    std::vector<std::string> outputPaths;
+    for (const auto& inputPath : options.inputPaths)
+    {
+        const std::string outputPath = options.batchDirectory + "/" + getFileName(inputPath);
+        if (std::find(outputPaths.begin(), outputPaths.end(), outputPath) != outputPaths.end())
+        {
+            std::fprintf(stderr, "error: %s: more than one input file has this name\n", getFileName(inputPath).c_str());
+            return 1;
+        }
+        outputPaths.push_back(outputPath);
+    }
+
+    // Every job renders one file with its own HallReverb instance. The instance is created on the worker thread, so its
+    // delay memory is placed on the NUMA node of the worker when the workers are pinned.
+    std::mutex outputMutex;
+    std::atomic<int> numFailedJobs{0};
+    const auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(options.numThreads, options.pinThreads);
+        std::printf("rendering %d files with %d threads\n", static_cast<int>(options.inputPaths.size()), pool.getNumThreads());
+        for (std::size_t i = 0; i < options.inputPaths.size(); ++i)
+        {
+            pool.submit([&, i](int) {
+                const auto jobStart = std::chrono::steady_clock::now();
+                RenderResult result;
+                std::string error;
+                const bool success = renderFile(options, options.inputPaths[i], outputPaths[i], result, error);
+                const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+
+                std::lock_guard<std::mutex> lock(outputMutex);
+                if (success)
+                    printResult(outputPaths[i], result, elapsedSeconds);
+                else
+                {
+                    std::fprintf(stderr, "error: %s\n", error.c_str());
+                    ++numFailedJobs;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    const double elapsedSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%d of %d files rendered in %.2f s\n", static_cast<int>(options.inputPaths.size()) - numFailedJobs.load(),
+                static_cast<int>(options.inputPaths.size()), elapsedSeconds);
+    return numFailedJobs.load() == 0 ? 0 : 1;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!options.batchDirectory.empty())
+        return renderBatch(options);
+
+    const auto start = std::chrono::steady_clock::now();
+    RenderResult result;
+    std::string error;
+    if (!renderFile(options, options.inputPaths[0], options.outputPath, result, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+    printResult(options.outputPath, result, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    return 0;
+}
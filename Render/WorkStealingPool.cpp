@@ -0,0 +1,162 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "WorkStealingPool.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace
+{
+// the CPUs this process may run on, workers are pinned to them in order
+std::vector<int> getAvailableCpus()
+{
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+    }
+#endif
+    return cpus;
+}
+
+void pinCurrentThread(int cpu)
+{
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+} // namespace
+
+WorkStealingPool::WorkStealingPool(int numThreads, bool pinThreads)
+{
+    const std::vector<int> cpus = pinThreads ? getAvailableCpus() : std::vector<int>();
+    if (numThreads <= 0)
+        numThreads = cpus.empty() ? static_cast<int>(std::thread::hardware_concurrency()) : static_cast<int>(cpus.size());
+    if (numThreads <= 0)
+        numThreads = 1;
+
+    for (int i = 0; i < numThreads; ++i)
+        workers.push_back(std::make_unique<Worker>());
+    for (int i = 0; i < numThreads; ++i)
+        threads.emplace_back(&WorkStealingPool::run, this, i, cpus.empty() ? -1 : cpus[i % cpus.size()]);
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+int WorkStealingPool::getNumThreads() const
+{
+    return static_cast<int>(threads.size());
+}
+
+void WorkStealingPool::submit(std::function<void(int)> job)
+{
+    Worker& worker = *workers[nextWorker];
+    nextWorker = (nextWorker + 1) % static_cast<int>(workers.size());
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.jobs.push_back(std::move(job));
+    }
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        ++numQueuedJobs;
+        ++numUnfinishedJobs;
+    }
+    jobsAvailable.notify_one();
+}
+
+void WorkStealingPool::wait()
+{
+    std::unique_lock<std::mutex> lock(stateMutex);
+    jobsDone.wait(lock, [this] { return numUnfinishedJobs == 0; });
+}
+
+void WorkStealingPool::run(int workerIndex, int cpu)
+{
+    if (cpu >= 0)
+        pinCurrentThread(cpu);
+
+    std::function<void(int)> job;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            jobsAvailable.wait(lock, [this] { return numQueuedJobs > 0 || stopping; });
+            if (numQueuedJobs == 0)
+                return;
+            // the job is reserved here, so popJob() finds one in some queue
+            --numQueuedJobs;
+        }
+
+        while (!popJob(workerIndex, job))
+            std::this_thread::yield();
+        job(workerIndex);
+        job = nullptr;
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--numUnfinishedJobs == 0)
+            jobsDone.notify_all();
+    }
+}
+
+bool WorkStealingPool::popJob(int workerIndex, std::function<void(int)>& job)
+{
+    // the newest own job first, then the oldest job of the other workers
+    const int numWorkers = static_cast<int>(workers.size());
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        Worker& worker = *workers[(workerIndex + i) % numWorkers];
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        if (worker.jobs.empty())
+            continue;
+        if (i == 0)
+        {
+            job = std::move(worker.jobs.back());
+            worker.jobs.pop_back();
+        }
+        else
+        {
+            job = std::move(worker.jobs.front());
+            worker.jobs.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
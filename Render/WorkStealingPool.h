@@ -0,0 +1,70 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A thread pool for coarse jobs like rendering a whole file. Every worker has its own job queue, jobs are submitted
+// round robin and a worker without jobs steals the oldest job from another worker, so long and short jobs even out.
+// Workers can be pinned to one CPU each (Linux only). Memory a job allocates and initializes is then placed on the
+// NUMA node of its worker by the first touch policy of the OS.
+class WorkStealingPool
+{
+public:
+    // numThreads <= 0 uses one thread per CPU
+    WorkStealingPool(int numThreads, bool pinThreads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int getNumThreads() const;
+    // the job gets the index of the worker that runs it
+    void submit(std::function<void(int)> job);
+    // blocks until all submitted jobs are done
+    void wait();
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<std::function<void(int)>> jobs;
+    };
+
+    void run(int workerIndex, int cpu);
+    bool popJob(int workerIndex, std::function<void(int)>& job);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    int nextWorker = 0;
+
+    // counts and sleeping, the queues themselves are guarded by the worker mutexes
+    std::mutex stateMutex;
+    std::condition_variable jobsAvailable;
+    std::condition_variable jobsDone;
+    int numQueuedJobs = 0;
+    int numUnfinishedJobs = 0;
+    bool stopping = false;
+};
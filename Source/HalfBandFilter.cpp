@@ -0,0 +1,66 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "HalfBandFilter.h"
+#include <algorithm>
+#include <iterator>
+
+namespace
+{
+// Kaiser windowed sinc (beta 7.86 and 8.5), the odd taps from the centre outwards. The centre tap is 0.5.
+constexpr float steepCoefficients[] = {0.316445178f,   -0.100622592f,  0.0548921819f,  -0.0339164473f, 0.0216465283f,
+                                       -0.0137262598f, 0.00844731681f, -0.00494950667f, 0.00270473861f, -0.00134042392f,
+                                       0.000574705841f, -0.000192242994f, 3.39418892e-05f};
+constexpr float wideCoefficients[] = {0.307961087f,   -0.0784279041f,  0.0267006984f,
+                                      -0.00745464249f, 0.00127518117f, -4.23578382e-05f};
+} // namespace
+
+HalfBandFilter::HalfBandFilter(Type newType)
+{
+    setType(newType);
+}
+
+void HalfBandFilter::setType(Type newType)
+{
+    if (newType == Type::steep)
+    {
+        coefficients = steepCoefficients;
+        numPairs = static_cast<int>(sizeof(steepCoefficients) / sizeof(steepCoefficients[0]));
+    }
+    else
+    {
+        coefficients = wideCoefficients;
+        numPairs = static_cast<int>(sizeof(wideCoefficients) / sizeof(wideCoefficients[0]));
+    }
+    reset();
+}
+
+void HalfBandFilter::reset()
+{
+    std::fill(std::begin(evenHistory), std::end(evenHistory), 0.0f);
+    std::fill(std::begin(oddHistory), std::end(oddHistory), 0.0f);
+    evenPosition = 0;
+    oddPosition = 0;
+}
+
+int HalfBandFilter::getLatency() const
+{
+    return 2 * numPairs - 1;
+}
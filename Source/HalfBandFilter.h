@@ -0,0 +1,93 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+// A linear phase half-band lowpass for decimation and interpolation by 2. All even taps of a half-band filter except the
+// centre tap are 0, so it is split into two polyphase branches: the odd taps, which are symmetric and processed as
+// pairs, and the centre tap, which is only a delay. Each sample at the lower rate costs one multiply per coefficient
+// pair.
+class HalfBandFilter
+{
+public:
+    enum class Type
+    {
+        steep, // passband up to 0.2 and stopband from 0.3 of the higher sample rate, -79 dB, 13 coefficient pairs
+        wide   // passband up to 0.125 and stopband from 0.375 of the higher sample rate, -85 dB, 6 coefficient pairs
+    };
+
+    explicit HalfBandFilter(Type newType = Type::steep);
+
+    void setType(Type newType);
+    void reset();
+    // the delay of the filter in samples at the higher sample rate
+    int getLatency() const;
+
+    // returns one sample at half the sample rate from two consecutive samples
+    inline float decimate(float first, float second)
+    {
+        push(evenHistory, evenPosition, 2 * numPairs, second);
+        push(oddHistory, oddPosition, numPairs, first);
+        return 0.5f * oddHistory[oddPosition + numPairs - 1] + sumPairs(evenHistory + evenPosition);
+    }
+
+    // writes two consecutive samples at twice the sample rate of the input sample
+    inline void interpolate(float input, float& first, float& second)
+    {
+        push(evenHistory, evenPosition, 2 * numPairs, input);
+        first = 2.0f * sumPairs(evenHistory + evenPosition);
+        second = evenHistory[evenPosition + numPairs - 1];
+    }
+
+private:
+    static constexpr int maxPairs = 13;
+    static constexpr int minPairs = 6;
+    const float* coefficients;
+    int numPairs;
+
+    // the histories are written twice, so that the taps can be read from the position without wrapping around
+    float evenHistory[4 * maxPairs];
+    float oddHistory[2 * maxPairs];
+    int evenPosition = 0;
+    int oddPosition = 0;
+
+    static inline void push(float* history, int& position, int length, float sample)
+    {
+        position = (position == 0 ? length : position) - 1;
+        history[position] = sample;
+        history[position + length] = sample;
+    }
+
+    // the sum of the odd taps, taps[0] is the newest sample
+    inline float sumPairs(const float* taps) const
+    {
+        // the loops are unrolled for the number of pairs of each type
+        return numPairs == maxPairs ? sumPairs<maxPairs>(taps) : sumPairs<minPairs>(taps);
+    }
+
+    template <int N>
+    inline float sumPairs(const float* taps) const
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < N; ++i)
+            sum += coefficients[i] * (taps[N - 1 - i] + taps[N + i]);
+        return sum;
+    }
+};
@@ -18,6 +18,276 @@
  */
 
 #include "HallReverb.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define HALLREVERB_FLUSH_DENORMALS_SSE 1
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_FP))
+#define HALLREVERB_FLUSH_DENORMALS_ARM 1
+#endif
+
+namespace
+{
+// Sets flush-to-zero and denormals-are-zero for the lifetime of the object and restores the previous mode afterwards,
+// like juce::ScopedNoDenormals, which isn't available to the engine. The filters and delay lines only flush denormals
+// themselves if Freeverb3 isn't built with DISABLE_UNDENORMAL (HALLREVERB_FLUSH_DENORMALS).
+class ScopedFlushDenormals
+{
+public:
+    ScopedFlushDenormals()
+    {
+#if defined(HALLREVERB_FLUSH_DENORMALS_SSE)
+        previousMode = _mm_getcsr();
+        _mm_setcsr(previousMode | flushToZero | denormalsAreZero);
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM) && defined(__aarch64__)
+        __asm__ __volatile__("mrs %0, fpcr" : "=r"(previousMode));
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(previousMode | flushToZero));
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM)
+        __asm__ __volatile__("vmrs %0, fpscr" : "=r"(previousMode));
+        __asm__ __volatile__("vmsr fpscr, %0" : : "r"(previousMode | flushToZero));
+#endif
+    }
+
+    ~ScopedFlushDenormals()
+    {
+#if defined(HALLREVERB_FLUSH_DENORMALS_SSE)
+        _mm_setcsr(previousMode);
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM) && defined(__aarch64__)
+        __asm__ __volatile__("msr fpcr, %0" : : "r"(previousMode));
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM)
+        __asm__ __volatile__("vmsr fpscr, %0" : : "r"(previousMode));
+#endif
+    }
+
+    ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+    ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+private:
+#if defined(HALLREVERB_FLUSH_DENORMALS_SSE)
+    static constexpr unsigned int flushToZero = 0x8000;     // MXCSR FTZ
+    static constexpr unsigned int denormalsAreZero = 0x0040; // MXCSR DAZ
+    unsigned int previousMode = 0;
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM) && defined(__aarch64__)
+    static constexpr std::uint64_t flushToZero = std::uint64_t{1} << 24; // FPCR FZ, also flushes denormal inputs
+    std::uint64_t previousMode = 0;
+#elif defined(HALLREVERB_FLUSH_DENORMALS_ARM)
+    static constexpr std::uint32_t flushToZero = std::uint32_t{1} << 24; // FPSCR FZ, also flushes denormal inputs
+    std::uint32_t previousMode = 0;
+#endif
+};
+
+// The early send and the output mix of one chunk, done per sample while the late reverb processes it. The input and
+// the early reflections of a sample are read before its output is written, so the output may be the input buffer.
+struct LateMix
+{
+    const float* leftIn;
+    const float* rightIn;
+    const float* leftEarly;
+    const float* rightEarly;
+    float* leftOut;
+    float* rightOut;
+    float earlySend, earlySendIncrement;
+    float dry, dryIncrement;
+    float earlyGain, earlyIncrement;
+    float lateGain, lateIncrement;
+    // for the silence detection
+    float earlyPeak = 0.0f;
+    float latePeak = 0.0f;
+
+    float left, right, leftEarlyOut, rightEarlyOut;
+
+    inline void read(float& leftLateIn, float& rightLateIn)
+    {
+        left = *leftIn++;
+        right = *rightIn++;
+        leftEarlyOut = *leftEarly++;
+        rightEarlyOut = *rightEarly++;
+        leftLateIn = earlySend * leftEarlyOut + left;
+        rightLateIn = earlySend * rightEarlyOut + right;
+        earlySend += earlySendIncrement;
+    }
+
+    inline void write(const float* lateOut)
+    {
+        *leftOut++ = dry * left + earlyGain * leftEarlyOut + lateGain * lateOut[0];
+        *rightOut++ = dry * right + earlyGain * rightEarlyOut + lateGain * lateOut[1];
+        dry += dryIncrement;
+        earlyGain += earlyIncrement;
+        lateGain += lateIncrement;
+        earlyPeak = std::max(earlyPeak, std::max(std::fabs(leftEarlyOut), std::fabs(rightEarlyOut)));
+        latePeak = std::max(latePeak, std::max(std::fabs(lateOut[0]), std::fabs(lateOut[1])));
+    }
+};
+
+// How one channel of a multichannel layout is mixed: its gains into the stereo input of the reverb, the gains of the
+// early reflections and the output of the late reverb with its gain.
+struct ChannelRouting
+{
+    float leftInput, rightInput;
+    float leftEarly, rightEarly;
+    int lateOutput;
+    float lateGain;
+};
+
+struct LayoutRouting
+{
+    int numChannels;
+    int numLateOutputs;
+    ChannelRouting channels[8];
+};
+
+// The late outputs 0 and 1 are the stereo pair with the stereo width, the others are the further taps of the FDN, of
+// which there are only enough for the surround channels. The centre and the LFE only get the dry signal, the centre
+// also feeds the reverb. In ambisonics the input is picked up by two virtual cardioids facing left and right and the
+// early reflections are encoded at the same directions, the late outputs form a diffuse field, in which X, Y and Z are
+// 1/sqrt(3) of W.
+constexpr float centreInput = 0.70710678f;
+constexpr float diffuseDirection = 0.57735027f;
+constexpr LayoutRouting layoutRoutings[] = {
+    // stereo
+    {2, 2, {{1.0f, 0.0f, 1.0f, 0.0f, 0, 1.0f}, {0.0f, 1.0f, 0.0f, 1.0f, 1, 1.0f}}},
+    // quad: L R Ls Rs
+    {4,
+     4,
+     {{1.0f, 0.0f, 1.0f, 0.0f, 0, 1.0f},
+      {0.0f, 1.0f, 0.0f, 1.0f, 1, 1.0f},
+      {1.0f, 0.0f, 0.0f, 0.0f, 2, 1.0f},
+      {0.0f, 1.0f, 0.0f, 0.0f, 3, 1.0f}}},
+    // 5.1: L R C LFE Ls Rs
+    {6,
+     4,
+     {{1.0f, 0.0f, 1.0f, 0.0f, 0, 1.0f},
+      {0.0f, 1.0f, 0.0f, 1.0f, 1, 1.0f},
+      {centreInput, centreInput, 0.0f, 0.0f, 0, 0.0f},
+      {0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f},
+      {1.0f, 0.0f, 0.0f, 0.0f, 2, 1.0f},
+      {0.0f, 1.0f, 0.0f, 0.0f, 3, 1.0f}}},
+    // 7.1: L R C LFE Ls Rs Lrs Rrs
+    {8,
+     6,
+     {{1.0f, 0.0f, 1.0f, 0.0f, 0, 1.0f},
+      {0.0f, 1.0f, 0.0f, 1.0f, 1, 1.0f},
+      {centreInput, centreInput, 0.0f, 0.0f, 0, 0.0f},
+      {0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f},
+      {1.0f, 0.0f, 0.0f, 0.0f, 2, 1.0f},
+      {0.0f, 1.0f, 0.0f, 0.0f, 3, 1.0f},
+      {1.0f, 0.0f, 0.0f, 0.0f, 4, 1.0f},
+      {0.0f, 1.0f, 0.0f, 0.0f, 5, 1.0f}}},
+    // first order ambisonics: W Y Z X
+    {4,
+     6,
+     {{0.5f, 0.5f, 1.0f, 1.0f, 2, 1.0f},
+      {0.5f, -0.5f, 1.0f, -1.0f, 3, diffuseDirection},
+      {0.0f, 0.0f, 0.0f, 0.0f, 4, diffuseDirection},
+      {0.0f, 0.0f, 0.0f, 0.0f, 5, diffuseDirection}}},
+};
+static_assert(sizeof(layoutRoutings) / sizeof(layoutRoutings[0]) ==
+                  static_cast<int>(HallReverb::ChannelLayout::numChannelLayouts),
+              "every channel layout needs a routing");
+
+const LayoutRouting& getLayoutRouting(HallReverb::ChannelLayout layout)
+{
+    return layoutRoutings[static_cast<int>(layout)];
+}
+
+// The same as LateMix for a multichannel layout, the stereo input of the reverb is the downmix of the channels. The
+// channels are processed in place.
+struct MultichannelMix
+{
+    float* const* channels;
+    const LayoutRouting* routing;
+    int index;
+    const float* leftIn;
+    const float* rightIn;
+    const float* leftEarly;
+    const float* rightEarly;
+    float earlySend, earlySendIncrement;
+    float dry, dryIncrement;
+    float earlyGain, earlyIncrement;
+    float lateGain, lateIncrement;
+    // for the silence detection
+    float earlyPeak = 0.0f;
+    float latePeak = 0.0f;
+
+    float leftEarlyOut, rightEarlyOut;
+
+    inline void read(float& leftLateIn, float& rightLateIn)
+    {
+        leftEarlyOut = *leftEarly++;
+        rightEarlyOut = *rightEarly++;
+        leftLateIn = earlySend * leftEarlyOut + *leftIn++;
+        rightLateIn = earlySend * rightEarlyOut + *rightIn++;
+        earlySend += earlySendIncrement;
+    }
+
+    inline void write(const float* lateOut)
+    {
+        for (int c = 0; c < routing->numChannels; ++c)
+        {
+            const ChannelRouting& channel = routing->channels[c];
+            const float early = channel.leftEarly * leftEarlyOut + channel.rightEarly * rightEarlyOut;
+            const float late = channel.lateGain * lateOut[channel.lateOutput];
+            float& sample = channels[c][index];
+            sample = dry * sample + earlyGain * early + lateGain * late;
+            latePeak = std::max(latePeak, std::fabs(late));
+        }
+        ++index;
+        dry += dryIncrement;
+        earlyGain += earlyIncrement;
+        lateGain += lateIncrement;
+        earlyPeak = std::max(earlyPeak, std::max(std::fabs(leftEarlyOut), std::fabs(rightEarlyOut)));
+    }
+};
+
+// the first four bytes of a binary state
+constexpr char stateTag[] = "HRVB";
+
+// the parameter ranges in the order of HallReverb::Parameter, the same as the plugin's
+struct ParameterRange
+{
+    float minimum;
+    float maximum;
+};
+
+const ParameterRange& getParameterRange(int index)
+{
+    static const ParameterRange ranges[HallReverb::numParameters] = {
+        {0.0f, 1.0f}, // dryLevel
+        {0.0f, 1.0f}, // earlyLevel
+        {0.0f, 1.0f}, // earlySendLevel
+        {0.0f, 1.0f}, // lateLevel
+        {0.0f, 16000.0f}, // earlyOutputHPF
+        {0.0f, 16000.0f}, // earlyOutputLPF
+        {0.4f, HallReverb::maxRoomSize}, // earlyRoomSize
+        {-1.0f, 1.0f}, // earlyStereoWidth
+        {-1.0f, 1.0f}, // lateApFeedback
+        {0.0f, 16000.0f}, // lateCrossOverFreqHigh
+        {0.0f, 16000.0f}, // lateCrossOverFreqLow
+        {0.1f, 30.0f}, // lateDecay
+        {0.1f, 5.0f}, // lateDecayFactorHigh
+        {0.1f, 5.0f}, // lateDecayFactorLow
+        {-1.0f, 1.0f}, // lateDiffusion
+        {0.0f, 5.0f}, // lateLFO1Freq
+        {0.0f, 5.0f}, // lateLFO2Freq
+        {0.0f, 1.0f}, // lateLFOFactor
+        {0.0f, 16000.0f}, // lateOutputHPF
+        {0.0f, 16000.0f}, // lateOutputLPF
+        {0.0f, HallReverb::maxPredelay}, // latePredelay
+        {0.4f, HallReverb::maxRoomSize}, // lateRoomSize
+        {0.0f, 50.0f}, // lateSpin
+        {0.0f, 1.0f}, // lateSpinFactor
+        {-1.0f, 1.0f}, // lateStereoWidth
+        {0.0f, 100.0f}, // lateWander
+    };
+    static const ParameterRange none{0.0f, 0.0f};
+    return index >= 0 && index < HallReverb::numParameters ? ranges[index] : none;
+}
+} // namespace
 
 HallReverb::HallReverb()
 {
@@ -25,6 +295,7 @@ HallReverb::HallReverb()
     early.setdryr(0.0f);
     early.setwetr(1.0f);
     early.loadPresetReflection(0);
+    longestReflection = early.getLongestReflection();
     early.setDiffusionApFreq(150.0f, 4.0f);
     early.setLRCrossApFreq(750.0f, 4.0f);
     early.setLRDelay(0.3f);
@@ -36,6 +307,13 @@ HallReverb::HallReverb()
     late.setMuteOnChange(false);
     late.setdccutfreq(2.5);
 
+    // allocate the delay lines for the largest room size and predelay, so that room size and predelay changes don't
+    // allocate memory
+    early.setMaxRSFactor(maxRoomSize);
+    late.setMaxRSFactor(maxRoomSize);
+    late.setMaxPreDelay(maxPredelay);
+    late.setPreDelayGlide(predelayGlide);
+
     // initialize everything else
     setSampleRate(44100.0f);
     setDryLevel(0.8f);
@@ -66,237 +344,884 @@ HallReverb::HallReverb()
     setLateSpinFactor(0.3f);
     setLateStereoWidth(1.0f);
     setLateWander(22.0f);
+
+    // the initial values are applied without a ramp
+    applyPendingParameters();
+    finishRamps();
 }
 
 void HallReverb::setSampleRate(float newSampleRate)
 {
     early.setSampleRate(newSampleRate);
-    late.setSampleRate(newSampleRate);
+    sampleRate = newSampleRate;
+    updateLateSampleRate();
+
+    // pending parameters are applied without a ramp and running ramps are finished, because their length depends on
+    // the sample rate
+    applyPendingParameters();
+    finishRamps();
+    for (auto* smoother : {&dryLevel, &earlyLevel, &earlySendLevel, &lateLevel, &earlyOutputHPF, &earlyOutputLPF,
+                           &lateCrossOverFreqHigh, &lateCrossOverFreqLow, &lateDecay, &lateDecayFactorHigh,
+                           &lateDecayFactorLow, &lateOutputHPF, &lateOutputLPF})
+        smoother->reset(sampleRate);
 }
 
 void HallReverb::process(const float* leftChannelIn,
                          const float* rightChannelIn, float* leftChannelOut,
                          float* rightChannelOut, int numSamples)
 {
-    // updating these parameters only once per buffer prevents segmention faults
-    if (earlyRoomSizeNeedsUpdate)
-    {
-        early.setRSFactor(earlyRoomSize);
-        earlyRoomSizeNeedsUpdate = false;
-    }
-    if (lateRoomSizeNeedsUpdate)
-    {
-        late.setRSFactor(lateRoomSize);
-        lateRoomSizeNeedsUpdate = false;
-    }
-    if (latePredelayNeedsUpdate)
-    {
-        late.setPreDelay(latePredelay);
-        latePredelayNeedsUpdate = false;
-    }
+    // denormals would slow down the filters and delay lines in the decaying tail by orders of magnitude
+    const ScopedFlushDenormals flushDenormals;
 
-    // split the buffer into fixed size chunks
-    for (int offset = 0; offset < numSamples; offset += bufferSize)
+    // parameters are applied once per buffer on the audio thread, so the delay lines and filters never change while
+    // they are processed (room size and predelay changes only move read positions)
+    applyPendingParameters();
+
+    // the clock is only read when profiling is enabled
+    const bool profiling = profilingEnabled.load(std::memory_order_relaxed);
+    ProfileClock::time_point stageStart;
+    if (profiling)
+        stageStart = ProfileClock::now();
+
+    // split the buffer into fixed size chunks, which are shorter while filter or decay parameters are ramped and end
+    // at scheduled parameter changes
+    for (int offset = 0; offset < numSamples;)
     {
-        int numSamplesInBuffer = numSamples - offset < bufferSize ? numSamples - offset : bufferSize;
+        // scheduled parameter changes are applied at their sample, the chunk ends before the next one
+        const int samplesToNextChange = applyScheduledChanges(offset);
+        const int chunkSize = std::min(isSmoothingControls() ? controlBlockSize : bufferSize, samplesToNextChange);
+        const int numSamplesInBuffer = numSamples - offset < chunkSize ? numSamples - offset : chunkSize;
+
+        updateControls(numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileParameters, stageStart);
 
-        for (int i = 0; i < numSamplesInBuffer; ++i)
+        const float* leftIn = leftChannelIn + offset;
+        const float* rightIn = (monoInput ? leftChannelIn : rightChannelIn) + offset;
+        float* leftOut = leftChannelOut + offset;
+        float* rightOut = rightChannelOut + offset;
+
+        const float inputPeak = getPeak(leftIn, rightIn, numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileInputPeak, stageStart);
+
+        // While the reverb is silent only the dry signal is mixed. Any input above the threshold wakes it up again in
+        // the same chunk, the state it left off with is below the threshold and can be processed further.
+        const bool inputIsSilent = inputPeak < silenceThreshold;
+        if (bypassed && inputIsSilent)
         {
-            leftBufferIn[i] = leftChannelIn[offset + i];
-            rightBufferIn[i] = rightChannelIn[offset + i];
+            processBypassed(leftIn, rightIn, leftOut, rightOut, numSamplesInBuffer);
+            if (profiling)
+                addProfileTime(profileBypass, stageStart);
+            offset += numSamplesInBuffer;
+            continue;
         }
+        bypassed = false;
 
-        early.processreplace(leftBufferIn,
-                             rightBufferIn,
+        // freeverb doesn't write to its input, it just isn't declared const
+        early.processreplace(const_cast<float*>(leftIn),
+                             const_cast<float*>(rightIn),
                              leftEarlyOut,
                              rightEarlyOut,
                              numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileEarly, stageStart);
+
+        // the levels are ramped linearly over the chunk, the increments are 0 if they are not smoothed
+        LateMix mix;
+        mix.leftIn = leftIn;
+        mix.rightIn = rightIn;
+        mix.leftEarly = leftEarlyOut;
+        mix.rightEarly = rightEarlyOut;
+        mix.leftOut = leftOut;
+        mix.rightOut = rightOut;
+        mix.earlySend = earlySendLevel.advanceBlock(numSamplesInBuffer, mix.earlySendIncrement);
+        mix.dry = dryLevel.advanceBlock(numSamplesInBuffer, mix.dryIncrement);
+        mix.earlyGain = earlyLevel.advanceBlock(numSamplesInBuffer, mix.earlyIncrement);
+        mix.lateGain = lateLevel.advanceBlock(numSamplesInBuffer, mix.lateIncrement);
+        lateResampler.process(late, mix, numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileLate, stageStart);
+
+        // the reverb is bypassed after the input and the reverb output stayed below the threshold for longer than the
+        // longest delay, so no delay line holds anything above it
+        if (inputIsSilent && mix.earlyPeak < silenceThreshold && mix.latePeak < silenceThreshold)
+        {
+            numSilentSamples += numSamplesInBuffer;
+            bypassed = numSilentSamples >= static_cast<int>(silenceHoldTime * sampleRate);
+        }
+        else
+            numSilentSamples = 0;
+
+        offset += numSamplesInBuffer;
+    }
+    advanceScheduledChanges(numSamples);
+
+    if (profiling)
+        profileNumSamples.fetch_add(static_cast<std::uint64_t>(numSamples), std::memory_order_relaxed);
+}
+
+void HallReverb::process(float* const* channels, int numSamples)
+{
+    if (channelLayout == ChannelLayout::stereo)
+    {
+        process(channels[0], channels[1], channels[0], channels[1], numSamples);
+        return;
+    }
 
-        for (int i = 0; i < numSamplesInBuffer; ++i)
+    const ScopedFlushDenormals flushDenormals;
+    applyPendingParameters();
+
+    const bool profiling = profilingEnabled.load(std::memory_order_relaxed);
+    ProfileClock::time_point stageStart;
+    if (profiling)
+        stageStart = ProfileClock::now();
+
+    const LayoutRouting& routing = getLayoutRouting(channelLayout);
+    for (int offset = 0; offset < numSamples;)
+    {
+        // scheduled parameter changes are applied at their sample, the chunk ends before the next one
+        const int samplesToNextChange = applyScheduledChanges(offset);
+        const int chunkSize = std::min(isSmoothingControls() ? controlBlockSize : bufferSize, samplesToNextChange);
+        const int numSamplesInBuffer = numSamples - offset < chunkSize ? numSamples - offset : chunkSize;
+
+        updateControls(numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileParameters, stageStart);
+
+        // the downmix is profiled with the input peak
+        std::fill(leftDownmix, leftDownmix + numSamplesInBuffer, 0.0f);
+        std::fill(rightDownmix, rightDownmix + numSamplesInBuffer, 0.0f);
+        for (int c = 0; c < routing.numChannels; ++c)
+        {
+            const ChannelRouting& channel = routing.channels[c];
+            const float* in = channels[c] + offset;
+            if (channel.leftInput != 0.0f)
+                for (int i = 0; i < numSamplesInBuffer; ++i)
+                    leftDownmix[i] += channel.leftInput * in[i];
+            if (channel.rightInput != 0.0f)
+                for (int i = 0; i < numSamplesInBuffer; ++i)
+                    rightDownmix[i] += channel.rightInput * in[i];
+        }
+        const float inputPeak = getPeak(leftDownmix, rightDownmix, numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileInputPeak, stageStart);
+
+        const bool inputIsSilent = inputPeak < silenceThreshold;
+        if (bypassed && inputIsSilent)
         {
-            leftLateIn[i] = earlySendLevel * leftEarlyOut[i] + leftBufferIn[i];
-            rightLateIn[i] = earlySendLevel * rightEarlyOut[i] + rightBufferIn[i];
+            processBypassed(channels, offset, numSamplesInBuffer);
+            if (profiling)
+                addProfileTime(profileBypass, stageStart);
+            offset += numSamplesInBuffer;
+            continue;
         }
+        bypassed = false;
+
+        early.processreplace(leftDownmix, rightDownmix, leftEarlyOut, rightEarlyOut, numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileEarly, stageStart);
 
-        late.processreplace(leftLateIn,
-                            rightLateIn,
-                            leftLateOut,
-                            rightLateOut,
-                            numSamplesInBuffer);
+        MultichannelMix mix;
+        mix.channels = channels;
+        mix.routing = &routing;
+        mix.index = offset;
+        mix.leftIn = leftDownmix;
+        mix.rightIn = rightDownmix;
+        mix.leftEarly = leftEarlyOut;
+        mix.rightEarly = rightEarlyOut;
+        mix.earlySend = earlySendLevel.advanceBlock(numSamplesInBuffer, mix.earlySendIncrement);
+        mix.dry = dryLevel.advanceBlock(numSamplesInBuffer, mix.dryIncrement);
+        mix.earlyGain = earlyLevel.advanceBlock(numSamplesInBuffer, mix.earlyIncrement);
+        mix.lateGain = lateLevel.advanceBlock(numSamplesInBuffer, mix.lateIncrement);
+        lateResampler.process(late, mix, numSamplesInBuffer);
+        if (profiling)
+            addProfileTime(profileLate, stageStart);
 
-        for (int i = 0; i < numSamplesInBuffer; ++i)
+        if (inputIsSilent && mix.earlyPeak < silenceThreshold && mix.latePeak < silenceThreshold)
         {
-            leftChannelOut[offset + i] = dryLevel * leftBufferIn[i] +
-                                         earlyLevel * leftEarlyOut[i] +
-                                         lateLevel * leftLateOut[i];
-            rightChannelOut[offset + i] = dryLevel * rightBufferIn[i] +
-                                          earlyLevel * rightEarlyOut[i] +
-                                          lateLevel * rightLateOut[i];
+            numSilentSamples += numSamplesInBuffer;
+            bypassed = numSilentSamples >= static_cast<int>(silenceHoldTime * sampleRate);
         }
+        else
+            numSilentSamples = 0;
+
+        offset += numSamplesInBuffer;
     }
+    advanceScheduledChanges(numSamples);
+
+    if (profiling)
+        profileNumSamples.fetch_add(static_cast<std::uint64_t>(numSamples), std::memory_order_relaxed);
 }
 
 void HallReverb::mute()
 {
     early.mute();
     late.mute();
+    lateResampler.reset();
+}
+
+void HallReverb::setMonoInput(bool shouldUseMonoInput)
+{
+    monoInput = shouldUseMonoInput;
+    early.setMonoInput(monoInput);
+    late.setMonoInput(monoInput);
+}
+
+bool HallReverb::isMonoInput() const
+{
+    return monoInput;
+}
+
+void HallReverb::setNumLateDelays(int newNumLateDelays)
+{
+    late.setnumdelays(newNumLateDelays);
+}
+
+int HallReverb::getNumLateDelays() const
+{
+    return static_cast<int>(late.getnumdelays());
+}
+
+void HallReverb::setLateDownsampling(bool shouldDownsampleLate)
+{
+    if (shouldDownsampleLate == lateDownsampling)
+        return;
+    lateDownsampling = shouldDownsampleLate;
+    updateLateSampleRate();
+}
+
+bool HallReverb::isLateDownsampling() const
+{
+    return lateDownsampling;
+}
+
+void HallReverb::updateLateSampleRate()
+{
+    int factor = 1;
+    if (lateDownsampling)
+        while (factor < 4 && sampleRate / static_cast<float>(2 * factor) >= minLateSampleRate)
+            factor *= 2;
+    late.setSampleRate(sampleRate / static_cast<float>(factor));
+    lateResampler.setFactor(factor);
+    // the latency of the resampling filters depends on the factor and the sample rate
+    applyLatePredelay(latePredelay);
+}
+
+void HallReverb::applyLatePredelay(float newLatePredelay)
+{
+    // the delay of the resampling is taken from the predelay, as far as it is long enough
+    latePredelay = newLatePredelay;
+    const float latency = 1000.0f * static_cast<float>(lateResampler.getLatency()) / sampleRate;
+    late.setPreDelay(std::max(0.0f, latePredelay - latency));
+}
+
+void HallReverb::setChannelLayout(ChannelLayout newChannelLayout)
+{
+    channelLayout = newChannelLayout;
+    late.setnumoutputs(getLayoutRouting(channelLayout).numLateOutputs);
+}
+
+HallReverb::ChannelLayout HallReverb::getChannelLayout() const
+{
+    return channelLayout;
+}
+
+int HallReverb::getNumChannels(ChannelLayout layout)
+{
+    return getLayoutRouting(layout).numChannels;
+}
+
+double HallReverb::getTailLengthSeconds() const
+{
+    auto getValue = [this](Parameter parameter) {
+        return static_cast<double>(parameterValues[static_cast<int>(parameter)].load(std::memory_order_relaxed));
+    };
+
+    // The early reflections end with the longest reflection, which is also sent to the late reverb. The late reverb
+    // starts after the predelay and decays by 60 dB per RT60 of its slowest band down to the silence threshold.
+    const double longestDecay = getValue(Parameter::lateDecay) *
+                                std::max({1.0, getValue(Parameter::lateDecayFactorLow), getValue(Parameter::lateDecayFactorHigh)});
+    const double decayToSilence = longestDecay * -20.0 * std::log10(static_cast<double>(silenceThreshold)) / 60.0;
+    return longestReflection * getValue(Parameter::earlyRoomSize) + getValue(Parameter::latePredelay) / 1000.0 + decayToSilence;
+}
+
+void HallReverb::processBypassed(const float* leftChannelIn, const float* rightChannelIn, float* leftChannelOut,
+                                 float* rightChannelOut, int numSamples)
+{
+    // the wet levels are only advanced, so they are up to date when the reverb wakes up
+    earlySendLevel.advance(numSamples);
+    earlyLevel.advance(numSamples);
+    lateLevel.advance(numSamples);
+
+    float dryIncrement;
+    float dry = dryLevel.advanceBlock(numSamples, dryIncrement);
+    for (int i = 0; i < numSamples; ++i)
+    {
+        // both inputs are read first, the left output may be the right input
+        const float left = leftChannelIn[i];
+        const float right = rightChannelIn[i];
+        leftChannelOut[i] = dry * left;
+        rightChannelOut[i] = dry * right;
+        dry += dryIncrement;
+    }
+}
+
+void HallReverb::processBypassed(float* const* channels, int offset, int numSamples)
+{
+    earlySendLevel.advance(numSamples);
+    earlyLevel.advance(numSamples);
+    lateLevel.advance(numSamples);
+
+    float dryIncrement;
+    const float dryStart = dryLevel.advanceBlock(numSamples, dryIncrement);
+    for (int c = 0; c < getNumChannels(channelLayout); ++c)
+    {
+        float* channel = channels[c] + offset;
+        float dry = dryStart;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            channel[i] *= dry;
+            dry += dryIncrement;
+        }
+    }
+}
+
+float HallReverb::getPeak(const float* left, const float* right, int numSamples)
+{
+    float peak = 0.0f;
+    for (int i = 0; i < numSamples; ++i)
+        peak = std::max(peak, std::max(std::fabs(left[i]), std::fabs(right[i])));
+    return peak;
+}
+
+bool HallReverb::isSmoothingControls() const
+{
+    return earlyOutputHPF.isSmoothing() || earlyOutputLPF.isSmoothing() || lateCrossOverFreqHigh.isSmoothing() ||
+           lateCrossOverFreqLow.isSmoothing() || lateDecay.isSmoothing() || lateDecayFactorHigh.isSmoothing() ||
+           lateDecayFactorLow.isSmoothing() || lateOutputHPF.isSmoothing() || lateOutputLPF.isSmoothing();
+}
+
+void HallReverb::updateControls(int numSamples)
+{
+    // only the ramped parameters are passed to freeverb, which recomputes their filter coefficients (the decay and
+    // crossover parameters of the late reverb are recomputed together once, when the chunk is processed)
+    if (earlyOutputHPF.isSmoothing())
+        early.setoutputhpf(earlyOutputHPF.advance(numSamples));
+    if (earlyOutputLPF.isSmoothing())
+        early.setoutputlpf(earlyOutputLPF.advance(numSamples));
+    if (lateCrossOverFreqHigh.isSmoothing())
+        late.setxover_high(lateCrossOverFreqHigh.advance(numSamples));
+    if (lateCrossOverFreqLow.isSmoothing())
+        late.setxover_low(lateCrossOverFreqLow.advance(numSamples));
+    if (lateDecay.isSmoothing())
+        late.setrt60(lateDecay.advance(numSamples));
+    if (lateDecayFactorHigh.isSmoothing())
+        late.setrt60_factor_high(lateDecayFactorHigh.advance(numSamples));
+    if (lateDecayFactorLow.isSmoothing())
+        late.setrt60_factor_low(lateDecayFactorLow.advance(numSamples));
+    if (lateOutputHPF.isSmoothing())
+        late.setoutputhpf(lateOutputHPF.advance(numSamples));
+    if (lateOutputLPF.isSmoothing())
+        late.setoutputlpf(lateOutputLPF.advance(numSamples));
+}
+
+void HallReverb::finishRamps()
+{
+    updateControls(std::numeric_limits<int>::max());
+    late.settlePreDelay();
+    for (auto* smoother : {&dryLevel, &earlyLevel, &earlySendLevel, &lateLevel})
+        smoother->setCurrentAndTargetValue(smoother->getTargetValue());
+}
+
+void HallReverb::setProfilingEnabled(bool shouldBeEnabled)
+{
+    profilingEnabled.store(shouldBeEnabled, std::memory_order_relaxed);
+}
+
+bool HallReverb::isProfilingEnabled() const
+{
+    return profilingEnabled.load(std::memory_order_relaxed);
+}
+
+HallReverb::Profile HallReverb::getProfile() const
+{
+    Profile profile;
+    profile.parameters = profileParameters.load(std::memory_order_relaxed);
+    profile.inputPeak = profileInputPeak.load(std::memory_order_relaxed);
+    profile.early = profileEarly.load(std::memory_order_relaxed);
+    profile.late = profileLate.load(std::memory_order_relaxed);
+    profile.bypass = profileBypass.load(std::memory_order_relaxed);
+    profile.numSamples = profileNumSamples.load(std::memory_order_relaxed);
+    return profile;
+}
+
+void HallReverb::resetProfile()
+{
+    profileParameters.store(0, std::memory_order_relaxed);
+    profileInputPeak.store(0, std::memory_order_relaxed);
+    profileEarly.store(0, std::memory_order_relaxed);
+    profileLate.store(0, std::memory_order_relaxed);
+    profileBypass.store(0, std::memory_order_relaxed);
+    profileNumSamples.store(0, std::memory_order_relaxed);
+}
+
+void HallReverb::addProfileTime(std::atomic<std::uint64_t>& stageTime, ProfileClock::time_point& stageStart)
+{
+    const auto stageEnd = ProfileClock::now();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(stageEnd - stageStart).count();
+    stageTime.fetch_add(static_cast<std::uint64_t>(elapsed), std::memory_order_relaxed);
+    stageStart = stageEnd;
+}
+
+void HallReverb::setParameter(Parameter parameter, float newValue)
+{
+    // the value is published before the pending bit, so the audio thread never reads an older value for it
+    const int index = static_cast<int>(parameter);
+    parameterValues[index].store(newValue, std::memory_order_relaxed);
+    pendingParameters.fetch_or(std::uint32_t{1} << index, std::memory_order_release);
+}
+
+void HallReverb::scheduleParameter(Parameter parameter, float newValue, int sampleOffset)
+{
+    const int index = static_cast<int>(parameter);
+    if (index < 0 || index >= numParameters)
+        return;
+    sampleOffset = std::max(sampleOffset, 0);
+    if (numScheduledChanges == maxScheduledChanges)
+    {
+        // The change is merged into the last queued change of the parameter, which then takes the value earlier. A
+        // change before it would be overwritten by it anyway. Only without a queued change of the parameter it is
+        // applied at the start of the next process() call, since no queued change can overwrite it then.
+        for (int i = numScheduledChanges - 1; i >= firstScheduledChange; --i)
+        {
+            if (scheduledChanges[i].parameter == parameter)
+            {
+                if (scheduledChanges[i].sampleOffset <= sampleOffset)
+                    scheduledChanges[i].newValue = newValue;
+                return;
+            }
+        }
+        setParameter(parameter, newValue);
+        return;
+    }
+
+    // insertion after the changes at the same or earlier offsets, the host sends them in order, so this rarely moves
+    // anything
+    int position = numScheduledChanges;
+    while (position > firstScheduledChange && scheduledChanges[position - 1].sampleOffset > sampleOffset)
+    {
+        scheduledChanges[position] = scheduledChanges[position - 1];
+        --position;
+    }
+    scheduledChanges[position] = {sampleOffset, parameter, newValue};
+    ++numScheduledChanges;
+}
+
+int HallReverb::applyScheduledChanges(int offset)
+{
+    while (firstScheduledChange < numScheduledChanges && scheduledChanges[firstScheduledChange].sampleOffset <= offset)
+    {
+        const ScheduledChange& change = scheduledChanges[firstScheduledChange++];
+        // the value is published like a setParameter() value, so getParameter() and the state follow the automation
+        parameterValues[static_cast<int>(change.parameter)].store(change.newValue, std::memory_order_relaxed);
+        applyParameter(change.parameter, change.newValue);
+    }
+    return firstScheduledChange < numScheduledChanges ? scheduledChanges[firstScheduledChange].sampleOffset - offset
+                                                      : std::numeric_limits<int>::max();
+}
+
+void HallReverb::advanceScheduledChanges(int numSamples)
+{
+    int remaining = 0;
+    for (int i = firstScheduledChange; i < numScheduledChanges; ++i, ++remaining)
+    {
+        scheduledChanges[remaining] = scheduledChanges[i];
+        scheduledChanges[remaining].sampleOffset -= numSamples;
+    }
+    numScheduledChanges = remaining;
+    firstScheduledChange = 0;
+}
+
+float HallReverb::getParameter(Parameter parameter) const
+{
+    const int index = static_cast<int>(parameter);
+    return index >= 0 && index < numParameters ? parameterValues[index].load(std::memory_order_relaxed) : 0.0f;
+}
+
+int HallReverb::getState(void* data, int maxSize) const
+{
+    if (data == nullptr || maxSize < stateSize)
+        return 0;
+
+    auto* bytes = static_cast<unsigned char*>(data);
+    auto writeWord = [&bytes](std::uint32_t word, int numBytes) {
+        for (int i = 0; i < numBytes; ++i)
+            *bytes++ = static_cast<unsigned char>(word >> (8 * i));
+    };
+    for (const char* c = stateTag; *c != 0; ++c)
+        *bytes++ = static_cast<unsigned char>(*c);
+    writeWord(stateVersion, 2);
+    writeWord(numParameters, 2);
+    for (int index = 0; index < numParameters; ++index)
+    {
+        const float value = parameterValues[index].load(std::memory_order_relaxed);
+        std::uint32_t word;
+        std::memcpy(&word, &value, sizeof(word));
+        writeWord(word, 4);
+    }
+    return stateSize;
+}
+
+bool HallReverb::readState(const void* data, int size, float* values)
+{
+    if (data == nullptr || values == nullptr || size < 8)
+        return false;
+
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    auto readWord = [&bytes](int numBytes) {
+        std::uint32_t word = 0;
+        for (int i = 0; i < numBytes; ++i)
+            word |= static_cast<std::uint32_t>(*bytes++) << (8 * i);
+        return word;
+    };
+    if (std::memcmp(bytes, stateTag, 4) != 0)
+        return false;
+    bytes += 4;
+    const auto version = static_cast<int>(readWord(2));
+    const auto numValues = static_cast<int>(readWord(2));
+    if (version != stateVersion || size < 8 + 4 * numValues)
+        return false;
+
+    // a newer state may have more parameters, which are skipped
+    for (int index = 0; index < numValues && index < numParameters; ++index)
+    {
+        const std::uint32_t word = readWord(4);
+        float value;
+        std::memcpy(&value, &word, sizeof(value));
+        if (!std::isfinite(value))
+            continue;
+        // a corrupt state must not reach the audio thread, e.g. a huge predelay would reallocate its delay lines
+        const auto parameter = static_cast<Parameter>(index);
+        values[index] = std::clamp(value, getParameterMinimum(parameter), getParameterMaximum(parameter));
+    }
+    return true;
+}
+
+bool HallReverb::applyState(const void* data, int size)
+{
+    float values[numParameters];
+    for (int index = 0; index < numParameters; ++index)
+        values[index] = parameterValues[index].load(std::memory_order_relaxed);
+    if (!readState(data, size, values))
+        return false;
+
+    std::uint32_t applied = 0;
+    for (int index = 0; index < numParameters; ++index)
+    {
+        if (values[index] == parameterValues[index].load(std::memory_order_relaxed))
+            continue;
+        parameterValues[index].store(values[index], std::memory_order_relaxed);
+        applied |= std::uint32_t{1} << index;
+    }
+    // all values are published with one pending mask, so the audio thread applies them in the same block
+    pendingParameters.fetch_or(applied, std::memory_order_release);
+    return true;
+}
+
+const char* HallReverb::getParameterName(Parameter parameter)
+{
+    static const char* const names[numParameters] = {
+        "dryLevel",
+        "earlyLevel",
+        "earlySendLevel",
+        "lateLevel",
+        "earlyOutputHPF",
+        "earlyOutputLPF",
+        "earlyRoomSize",
+        "earlyStereoWidth",
+        "lateApFeedback",
+        "lateCrossOverFreqHigh",
+        "lateCrossOverFreqLow",
+        "lateDecay",
+        "lateDecayFactorHigh",
+        "lateDecayFactorLow",
+        "lateDiffusion",
+        "lateLFO1Freq",
+        "lateLFO2Freq",
+        "lateLFOFactor",
+        "lateOutputHPF",
+        "lateOutputLPF",
+        "latePredelay",
+        "lateRoomSize",
+        "lateSpin",
+        "lateSpinFactor",
+        "lateStereoWidth",
+        "lateWander",
+    };
+    const int index = static_cast<int>(parameter);
+    return index >= 0 && index < numParameters ? names[index] : "";
+}
+
+float HallReverb::getParameterMinimum(Parameter parameter)
+{
+    return getParameterRange(static_cast<int>(parameter)).minimum;
+}
+
+float HallReverb::getParameterMaximum(Parameter parameter)
+{
+    return getParameterRange(static_cast<int>(parameter)).maximum;
+}
+
+void HallReverb::applyPendingParameters()
+{
+    std::uint32_t pending = pendingParameters.exchange(0, std::memory_order_acquire);
+    for (int index = 0; pending != 0; ++index, pending >>= 1)
+    {
+        if (pending & 1)
+            applyParameter(static_cast<Parameter>(index), parameterValues[index].load(std::memory_order_relaxed));
+    }
+}
+
+void HallReverb::applyParameter(Parameter parameter, float newValue)
+{
+    switch (parameter)
+    {
+    case Parameter::dryLevel:
+        dryLevel.setTargetValue(newValue);
+        break;
+    case Parameter::earlyLevel:
+        earlyLevel.setTargetValue(newValue);
+        break;
+    case Parameter::earlySendLevel:
+        earlySendLevel.setTargetValue(newValue);
+        break;
+    case Parameter::lateLevel:
+        lateLevel.setTargetValue(newValue);
+        break;
+    case Parameter::earlyOutputHPF:
+        earlyOutputHPF.setTargetValue(newValue);
+        break;
+    case Parameter::earlyOutputLPF:
+        earlyOutputLPF.setTargetValue(newValue);
+        break;
+    case Parameter::earlyRoomSize:
+        early.setRSFactor(newValue);
+        break;
+    case Parameter::earlyStereoWidth:
+        early.setwidth(newValue);
+        break;
+    case Parameter::lateApFeedback:
+        late.setapfeedback(newValue);
+        break;
+    case Parameter::lateCrossOverFreqHigh:
+        lateCrossOverFreqHigh.setTargetValue(newValue);
+        break;
+    case Parameter::lateCrossOverFreqLow:
+        lateCrossOverFreqLow.setTargetValue(newValue);
+        break;
+    case Parameter::lateDecay:
+        lateDecay.setTargetValue(newValue);
+        break;
+    case Parameter::lateDecayFactorHigh:
+        lateDecayFactorHigh.setTargetValue(newValue);
+        break;
+    case Parameter::lateDecayFactorLow:
+        lateDecayFactorLow.setTargetValue(newValue);
+        break;
+    case Parameter::lateDiffusion:
+        late.setidiffusion1(newValue);
+        break;
+    case Parameter::lateLFO1Freq:
+        late.setlfo1freq(newValue);
+        break;
+    case Parameter::lateLFO2Freq:
+        late.setlfo2freq(newValue);
+        break;
+    case Parameter::lateLFOFactor:
+        late.setlfofactor(newValue);
+        break;
+    case Parameter::lateOutputHPF:
+        lateOutputHPF.setTargetValue(newValue);
+        break;
+    case Parameter::lateOutputLPF:
+        lateOutputLPF.setTargetValue(newValue);
+        break;
+    case Parameter::latePredelay:
+        applyLatePredelay(newValue);
+        break;
+    case Parameter::lateRoomSize:
+        late.setRSFactor(newValue);
+        break;
+    case Parameter::lateSpin:
+        late.setspin(newValue);
+        break;
+    case Parameter::lateSpinFactor:
+        late.setspinfactor(newValue);
+        break;
+    case Parameter::lateStereoWidth:
+        late.setwidth(newValue);
+        break;
+    case Parameter::lateWander:
+        late.setwander(newValue);
+        break;
+    case Parameter::numParameters:
+        break;
+    }
 }
 
 void HallReverb::setDryLevel(float newDryLevel)
 {
     // The level of the dry signal. (DRY)
-    dryLevel = newDryLevel;
+    setParameter(Parameter::dryLevel, newDryLevel);
 }
 
 void HallReverb::setEarlyLevel(float newEarlyLevel)
 {
     // The level of the early reflection signal. (EWET)
-    earlyLevel = newEarlyLevel;
+    setParameter(Parameter::earlyLevel, newEarlyLevel);
 }
 
 void HallReverb::setEarlySendLevel(float newEarlySend)
 {
     // The level of the early reflection signal which was send to the late reverberation. (ESEN)
-    earlySendLevel = newEarlySend;
+    setParameter(Parameter::earlySendLevel, newEarlySend);
 }
 
 void HallReverb::setLateLevel(float newLateLevel)
 {
     // The level of the late reverberation signal. (LWET)
-    lateLevel = newLateLevel;
+    setParameter(Parameter::lateLevel, newLateLevel);
 }
 
 void HallReverb::setEarlyOutputHPF(float newEarlyOutputHPF)
 {
     // The cutoff frequency of the high pass filter of the early reflection signal. (EHPF)
-    early.setoutputhpf(newEarlyOutputHPF);
+    setParameter(Parameter::earlyOutputHPF, newEarlyOutputHPF);
 }
 
 void HallReverb::setEarlyOutputLPF(float newEarlyOutputLPF)
 {
     // The cutoff frequency of the low pass filter of the early reflection signal. (ELPF)
-    early.setoutputlpf(newEarlyOutputLPF);
+    setParameter(Parameter::earlyOutputLPF, newEarlyOutputLPF);
 }
 
 void HallReverb::setEarlyRoomSize(float newEarlyRoomSize)
 {
     // The room size of the early reflection. (EFAC)
-    earlyRoomSize = newEarlyRoomSize;
-    earlyRoomSizeNeedsUpdate = true;
+    setParameter(Parameter::earlyRoomSize, newEarlyRoomSize);
 }
 
 void HallReverb::setEarlyStereoWidth(float newEarlyStereoWidth)
 {
     // The stereo width of the early reflection. (EWID)
-    early.setwidth(newEarlyStereoWidth);
+    setParameter(Parameter::earlyStereoWidth, newEarlyStereoWidth);
 }
 
 void HallReverb::setLateApFeedback(float newLateApFeedback)
 {
     // The strength of the allpass diffusor in the FDN loop. (ADIF)
-    late.setapfeedback(newLateApFeedback);
+    setParameter(Parameter::lateApFeedback, newLateApFeedback);
 }
 
 void HallReverb::setLateCrossOverFreqHigh(float newLateCrossOverFreqHigh)
 {
     // The high crossover frequency for the late reverb time. (XOH)
-    late.setxover_high(newLateCrossOverFreqHigh);
+    setParameter(Parameter::lateCrossOverFreqHigh, newLateCrossOverFreqHigh);
 }
 
 void HallReverb::setLateCrossOverFreqLow(float newLateCrossOverFreqLow)
 {
     // The low crossover frequency for the late reverb time. (XOL)
-    late.setxover_low(newLateCrossOverFreqLow);
+    setParameter(Parameter::lateCrossOverFreqLow, newLateCrossOverFreqLow);
 }
 
 void HallReverb::setLateDecay(float newLateDecay)
 {
     // The reverb time. (RT60)
-    late.setrt60(newLateDecay);
+    setParameter(Parameter::lateDecay, newLateDecay);
 }
 
 void HallReverb::setLateDecayFactorHigh(float newLateDecayFactorHigh)
 {
     // The high frequency gain for the late reverb time. (RTHi)
-    late.setrt60_factor_high(newLateDecayFactorHigh);
+    setParameter(Parameter::lateDecayFactorHigh, newLateDecayFactorHigh);
 }
 
 void HallReverb::setLateDecayFactorLow(float newLateDecayFactorLow)
 {
     // The low frequency gain for the late reverb time. (RTLo)
-    late.setrt60_factor_low(newLateDecayFactorLow);
+    setParameter(Parameter::lateDecayFactorLow, newLateDecayFactorLow);
 }
 
 void HallReverb::setLateDiffusion(float newLateDiffusion)
 {
     // The strength of the input allpass diffusor. (IDIF)
-    late.setidiffusion1(newLateDiffusion);
+    setParameter(Parameter::lateDiffusion, newLateDiffusion);
 }
 
 void HallReverb::setLateLFO1Freq(float newLateLFO1Freq)
 {
     // The first frequency of the LFO in the FDN loop. (LFO1)
-    late.setlfo1freq(newLateLFO1Freq);
+    setParameter(Parameter::lateLFO1Freq, newLateLFO1Freq);
 }
 
 void HallReverb::setLateLFO2Freq(float newLateLFO2Freq)
 {
     // The second frequency of the LFO in the FDN loop. (LFO2)
-    late.setlfo2freq(newLateLFO2Freq);
+    setParameter(Parameter::lateLFO2Freq, newLateLFO2Freq);
 }
 
 void HallReverb::setLateLFOFactor(float newLateLFOFactor)
 {
     // The strength of the LFO in the FDN loop. (LFOF)
-    late.setlfofactor(newLateLFOFactor);
+    setParameter(Parameter::lateLFOFactor, newLateLFOFactor);
 }
 
 void HallReverb::setLateOutputHPF(float newLateOutputHPF)
 {
     // The cutoff frequency of the high pass filter of the late reverb signal. (LHPF)
-    late.setoutputhpf(newLateOutputHPF);
+    setParameter(Parameter::lateOutputHPF, newLateOutputHPF);
 }
 
 void HallReverb::setLateOutputLPF(float newLateOutputLPF)
 {
     // The cutoff frequency of the low pass filter of the late reverb signal. (LLPF)
-    late.setoutputlpf(newLateOutputLPF);
+    setParameter(Parameter::lateOutputLPF, newLateOutputLPF);
 }
 
 void HallReverb::setLatePredelay(float newLatePredelay)
 {
     // The length of the initial delay of the late reverb wet signal in ms. (IDEL)
-    latePredelay = newLatePredelay;
-    latePredelayNeedsUpdate = true;
+    setParameter(Parameter::latePredelay, newLatePredelay);
 }
 
 void HallReverb::setLateRoomSize(float newLateRoomSize)
 {
     // The late reverb's room size. (SIZE)
-    lateRoomSize = newLateRoomSize;
-    lateRoomSizeNeedsUpdate = true;
+    setParameter(Parameter::lateRoomSize, newLateRoomSize);
 }
 
 void HallReverb::setLateSpin(float newLateSpin)
 {
     // The frequency of the output chorus. (SPN)
-    late.setspin(newLateSpin);
+    setParameter(Parameter::lateSpin, newLateSpin);
 }
 
 void HallReverb::setLateSpinFactor(float newLateSpinFactor)
 {
     // The strength of the output chorus. (SPNF)
-    late.setspinfactor(newLateSpinFactor);
+    setParameter(Parameter::lateSpinFactor, newLateSpinFactor);
 }
 
 void HallReverb::setLateStereoWidth(float newLateStereoWidth)
 {
     // The stereo width of the late reverberation. (LWID)
-    late.setwidth(newLateStereoWidth);
+    setParameter(Parameter::lateStereoWidth, newLateStereoWidth);
 }
 
 void HallReverb::setLateWander(float newLateWander)
 {
     // The length of the output chorus. (WAN)
-    late.setwander(newLateWander);
+    setParameter(Parameter::lateWander, newLateWander);
 }
@@ -19,8 +19,13 @@
 
 #pragma once
 
+#include "LateResampler.h"
+#include "ParameterSmoother.h"
 #include "freeverb/earlyref.hpp"
 #include "freeverb/zrev2.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 
 class HallReverb
 {
@@ -28,8 +33,143 @@ public:
     HallReverb();
 
     void setSampleRate(float newSampleRate);
+    // The output may be the same buffer as the input (in place processing) and both inputs may be the same buffer (mono
+    // input), nothing is copied in either case.
     void process(const float* leftChannelIn, const float* rightChannelIn, float* leftChannelOut, float* rightChannelOut, int numSamples);
     void mute();
+    // In the mono input mode the right input is ignored and the input side of both engines is computed once for both
+    // channels. This sounds slightly different from feeding the same signal to both inputs, because the late reverb
+    // only uses one input diffuser. It must not be changed while processing, e.g. call it in prepareToPlay().
+    void setMonoInput(bool shouldUseMonoInput);
+    bool isMonoInput() const;
+    // The number of delay lines of the late reverb, 4, 8 (the default), 16 or 32. 4 lines are slightly cheaper (most of
+    // the time is spent in the input diffusion and the outputs), but the tail is sparser and the surround channels get
+    // copies of the stereo late reverb. 16 and 32 lines give a denser tail for about 1.3 and 1.6 times the cost.
+    // Other values are ignored. It must not be changed while processing, e.g. call it in prepareToPlay().
+    void setNumLateDelays(int newNumLateDelays);
+    int getNumLateDelays() const;
+    // At sample rates of 88.2 kHz and above the late reverb can run at a half or a quarter of the sample rate (at least
+    // 44.1 kHz), which makes it about 1.7 or 3 times cheaper. The early reflections and the mix stay at the full rate.
+    // The late reverb then only reaches up to 0.4 times its sample rate, which is above the range of the late output
+    // LPF, and the resampling filters delay it by about 0.6 ms, which is taken from the predelay. It must not be changed
+    // while processing, e.g. call it in prepareToPlay().
+    void setLateDownsampling(bool shouldDownsampleLate);
+    bool isLateDownsampling() const;
+
+    // The channel layouts of the multichannel process() in the channel order of the plugin formats: quad is L R Ls Rs,
+    // 5.1 is L R C LFE Ls Rs, 7.1 is L R C LFE Ls Rs Lrs Rrs and first order ambisonics is W Y Z X (ACN order, SN3D
+    // normalization). The channels are downmixed to the stereo input of the reverb, the early reflections go to the
+    // front pair (W and Y) and every channel except the centre and the LFE gets its own decorrelated output of the
+    // late reverb. The layout must not be changed while processing, e.g. call it in prepareToPlay().
+    enum class ChannelLayout
+    {
+        stereo,
+        quad,
+        surround51,
+        surround71,
+        ambisonic,
+        numChannelLayouts
+    };
+    void setChannelLayout(ChannelLayout newChannelLayout);
+    ChannelLayout getChannelLayout() const;
+    static int getNumChannels(ChannelLayout layout);
+    // processes the getNumChannels() channels of the channel layout in place, the stereo layout is the same as the
+    // stereo process()
+    void process(float* const* channels, int numSamples);
+    // the time until the output decays below -120 dBFS after the input stopped, computed from the latest parameter
+    // values, may be called from any thread
+    double getTailLengthSeconds() const;
+
+    // Parameters may be set from any thread. They are handed to the audio thread through a lock-free mailbox and
+    // applied at the start of the next process() call, a parameter set twice in between is applied once. Parameters
+    // set before setSampleRate() are applied there without a ramp.
+    enum class Parameter
+    {
+        dryLevel,
+        earlyLevel,
+        earlySendLevel,
+        lateLevel,
+        earlyOutputHPF,
+        earlyOutputLPF,
+        earlyRoomSize,
+        earlyStereoWidth,
+        lateApFeedback,
+        lateCrossOverFreqHigh,
+        lateCrossOverFreqLow,
+        lateDecay,
+        lateDecayFactorHigh,
+        lateDecayFactorLow,
+        lateDiffusion,
+        lateLFO1Freq,
+        lateLFO2Freq,
+        lateLFOFactor,
+        lateOutputHPF,
+        lateOutputLPF,
+        latePredelay,
+        lateRoomSize,
+        lateSpin,
+        lateSpinFactor,
+        lateStereoWidth,
+        lateWander,
+        numParameters
+    };
+    static constexpr int numParameters = static_cast<int>(Parameter::numParameters);
+    void setParameter(Parameter parameter, float newValue);
+    // Sample accurate automation on the audio thread: the parameter changes at sampleOffset samples into the next
+    // process() call, which splits its buffer into chunks at the changes. Changes beyond its buffer are carried into
+    // the following calls. It must only be called from the audio thread between process() calls, the changes of the
+    // same parameter at the same offset are applied in the order they were scheduled. If maxScheduledChanges are
+    // waiting, the change replaces the value of the last waiting change of the parameter (or is applied at the start of
+    // the next process() call if there is none), so the latest value still wins.
+    static constexpr int maxScheduledChanges = 256;
+    void scheduleParameter(Parameter parameter, float newValue, int sampleOffset);
+    // the latest value set for a parameter, may be called from any thread
+    float getParameter(Parameter parameter) const;
+    // the parameter names are the same as the plugin's parameter IDs
+    static const char* getParameterName(Parameter parameter);
+    // the range of a parameter, the same as the plugin's parameter range
+    static float getParameterMinimum(Parameter parameter);
+    static float getParameterMaximum(Parameter parameter);
+
+    // The binary state of all parameters for presets and plugin states: the tag "HRVB", a 16 bit version and a 16 bit
+    // number of values, then the values as 32 bit floats in the order of Parameter, all little endian. New parameters
+    // are appended without a new version, so older states just lack the last values.
+    static constexpr int stateVersion = 1;
+    static constexpr int stateSize = 8 + 4 * numParameters;
+    // writes the latest parameter values, returns the number of bytes written or 0 if maxSize is less than stateSize
+    int getState(void* data, int maxSize) const;
+    // Sets all parameters of a state at once, like setParameter() they are applied at the start of the next process()
+    // call, room size changes reconfigure the delay lines once. Parameters missing in an older state and non-finite
+    // values keep their values, values out of range are clamped to it. Returns false without changing anything if the
+    // data is no state of a known version.
+    bool applyState(const void* data, int size);
+    // Reads the values of a state into values (numParameters floats) without setting them, e.g. to update the plugin's
+    // parameters before the reverb. Values missing in the state or non-finite are left unchanged and values out of range
+    // are clamped like in applyState(). Returns false without changing anything if the data is no state of a known
+    // version.
+    static bool readState(const void* data, int size, float* values);
+
+    // the largest room size, the delay lines are allocated for it in setSampleRate
+    static constexpr float maxRoomSize = 3.6f;
+    // the largest predelay in ms, longer predelays reallocate the late reverb's output delay lines
+    static constexpr float maxPredelay = 200.0f;
+
+    // profiling
+    struct Profile
+    {
+        // accumulated processing time of each stage in nanoseconds
+        std::uint64_t parameters = 0;
+        std::uint64_t inputPeak = 0;
+        std::uint64_t early = 0;
+        std::uint64_t late = 0; // including the early send and the output mix
+        std::uint64_t bypass = 0; // the dry mix while the reverb is bypassed
+        // number of samples processed while profiling was enabled
+        std::uint64_t numSamples = 0;
+    };
+    void setProfilingEnabled(bool shouldBeEnabled);
+    bool isProfilingEnabled() const;
+    Profile getProfile() const;
+    void resetProfile();
 
     // output
     void setDryLevel(float newDryLevel);
@@ -64,28 +204,101 @@ public:
     void setLateWander(float newLateWander);
 
 private:
-    float dryLevel;
-    float earlyLevel;
-    float earlySendLevel;
-    float lateLevel;
-
-    bool earlyRoomSizeNeedsUpdate = false;
-    float earlyRoomSize;
-    bool lateRoomSizeNeedsUpdate = false;
-    float lateRoomSize;
-    bool latePredelayNeedsUpdate = false;
-    float latePredelay;
+    // levels are ramped per sample, filter and decay parameters are recomputed every controlBlockSize samples while
+    // they are ramped
+    static constexpr float levelRampTime = 0.02f;
+    static constexpr float controlRampTime = 0.05f;
+    static constexpr int controlBlockSize = 64;
+    float sampleRate = 44100.0f;
+    bool monoInput = false;
+    bool lateDownsampling = false;
+    // the lowest sample rate of the downsampled late reverb
+    static constexpr float minLateSampleRate = 44100.0f;
+    ChannelLayout channelLayout = ChannelLayout::stereo;
+
+    ParameterSmoother dryLevel{ParameterSmoother::Type::linear, levelRampTime};
+    ParameterSmoother earlyLevel{ParameterSmoother::Type::linear, levelRampTime};
+    ParameterSmoother earlySendLevel{ParameterSmoother::Type::linear, levelRampTime};
+    ParameterSmoother lateLevel{ParameterSmoother::Type::linear, levelRampTime};
+
+    ParameterSmoother earlyOutputHPF{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother earlyOutputLPF{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateCrossOverFreqHigh{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateCrossOverFreqLow{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateDecay{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateDecayFactorHigh{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateDecayFactorLow{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateOutputHPF{ParameterSmoother::Type::exponential, controlRampTime};
+    ParameterSmoother lateOutputLPF{ParameterSmoother::Type::exponential, controlRampTime};
 
+    // parameter mailbox, written by any thread and read by the audio thread
+    static_assert(numParameters <= 32, "the pending parameters don't fit into the bit mask");
+    std::atomic<float> parameterValues[numParameters];
+    std::atomic<std::uint32_t> pendingParameters{0};
+    void applyPendingParameters();
+    void applyParameter(Parameter parameter, float newValue);
+
+    // the scheduled changes sorted by their offset, the ones before firstScheduledChange are applied
+    struct ScheduledChange
+    {
+        int sampleOffset;
+        Parameter parameter;
+        float newValue;
+    };
+    ScheduledChange scheduledChanges[maxScheduledChanges];
+    int numScheduledChanges = 0;
+    int firstScheduledChange = 0;
+    // applies the changes due at offset and returns the number of samples until the next one
+    int applyScheduledChanges(int offset);
+    // moves the remaining changes numSamples earlier after a process() call
+    void advanceScheduledChanges(int numSamples);
+
+    bool isSmoothingControls() const;
+    void updateControls(int numSamples);
+    void finishRamps();
+    // the predelay without the latency of the downsampled late reverb in ms
+    float latePredelay = 0.0f;
+    // the speed of the predelay's read heads in samples per sample, a change of 200 ms takes 0.8 s and bends the pitch
+    // of the late reverb by a few semitones instead of clicking
+    static constexpr float predelayGlide = 0.25f;
+    void updateLateSampleRate();
+    void applyLatePredelay(float newLatePredelay);
+
+    // the time of the last early reflection at room size 1, the reflection pattern is set once in the constructor
+    float longestReflection = 0.0f;
+
+    // silence detection, the reverb is bypassed when it can't produce anything above -120 dBFS
+    static constexpr float silenceThreshold = 1.0e-6f;
+    // longer than the longest path through the delay lines at the largest room size (early taps up to 1.8 s, late
+    // delay lines up to 0.93 s and the predelay) in seconds
+    static constexpr float silenceHoldTime = 3.0f;
+    bool bypassed = false;
+    int numSilentSamples = 0;
+    void processBypassed(const float* leftChannelIn, const float* rightChannelIn, float* leftChannelOut,
+                         float* rightChannelOut, int numSamples);
+    void processBypassed(float* const* channels, int offset, int numSamples);
+    static float getPeak(const float* left, const float* right, int numSamples);
+
+    // the only intermediate buffers, the early send and the output mix are done per sample in the late reverb
     static constexpr int bufferSize = 512;
-    float leftBufferIn[bufferSize];
-    float rightBufferIn[bufferSize];
     float leftEarlyOut[bufferSize];
     float rightEarlyOut[bufferSize];
-    float leftLateIn[bufferSize];
-    float rightLateIn[bufferSize];
-    float leftLateOut[bufferSize];
-    float rightLateOut[bufferSize];
+    // the stereo downmix of the multichannel input
+    float leftDownmix[bufferSize];
+    float rightDownmix[bufferSize];
 
     fv3::earlyref_f early;
     fv3::zrev2_f late;
+    LateResampler lateResampler;
+
+    // the profile is written by the audio thread and may be read from any other thread
+    using ProfileClock = std::chrono::steady_clock;
+    void addProfileTime(std::atomic<std::uint64_t>& stageTime, ProfileClock::time_point& stageStart);
+    std::atomic<bool> profilingEnabled{false};
+    std::atomic<std::uint64_t> profileParameters{0};
+    std::atomic<std::uint64_t> profileInputPeak{0};
+    std::atomic<std::uint64_t> profileEarly{0};
+    std::atomic<std::uint64_t> profileLate{0};
+    std::atomic<std::uint64_t> profileBypass{0};
+    std::atomic<std::uint64_t> profileNumSamples{0};
 };
@@ -0,0 +1,72 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "LateResampler.h"
+#include <algorithm>
+#include <iterator>
+
+void LateResampler::setFactor(int newFactor)
+{
+    factor = newFactor == 2 || newFactor == 4 ? newFactor : 1;
+
+    // the first stage needs the steep filter if it is the only one, otherwise the second stage removes everything above
+    // its passband and the first stage only has to keep it from aliasing
+    const auto firstStage = factor == 4 ? HalfBandFilter::Type::wide : HalfBandFilter::Type::steep;
+    leftDecimators[0].setType(firstStage);
+    rightDecimators[0].setType(firstStage);
+    leftDecimators[1].setType(HalfBandFilter::Type::steep);
+    rightDecimators[1].setType(HalfBandFilter::Type::steep);
+    for (int c = 0; c < FV3_ZREV2_MAX_OUTPUTS; ++c)
+    {
+        interpolators[0][c].setType(firstStage);
+        interpolators[1][c].setType(HalfBandFilter::Type::steep);
+    }
+    reset();
+}
+
+int LateResampler::getFactor() const
+{
+    return factor;
+}
+
+void LateResampler::reset()
+{
+    phase = 0;
+    std::fill(std::begin(leftInput), std::end(leftInput), 0.0f);
+    std::fill(std::begin(rightInput), std::end(rightInput), 0.0f);
+    std::fill(&output[0][0], &output[0][0] + maxFactor * FV3_ZREV2_MAX_OUTPUTS, 0.0f);
+    for (int stage = 0; stage < 2; ++stage)
+    {
+        leftDecimators[stage].reset();
+        rightDecimators[stage].reset();
+        for (int c = 0; c < FV3_ZREV2_MAX_OUTPUTS; ++c)
+            interpolators[stage][c].reset();
+    }
+}
+
+int LateResampler::getLatency() const
+{
+    // a group of samples and the decimation and interpolation filters of each stage
+    if (factor == 1)
+        return 0;
+    if (factor == 2)
+        return 2 + 2 * leftDecimators[0].getLatency();
+    return 4 + 2 * leftDecimators[0].getLatency() + 4 * leftDecimators[1].getLatency();
+}
@@ -0,0 +1,128 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include "HalfBandFilter.h"
+#include "freeverb/zrev2.hpp"
+
+// Runs the late reverb at a half or a quarter of the sample rate. Its input is decimated and its outputs are
+// interpolated with half-band filters, while the mix (the input, the early send and the output mix) is still done per
+// sample at the full rate. Each sample is mixed with the late output computed from the previous group of factor
+// samples, so blocks of any length can be processed: a group that isn't complete at the end of a block is completed in
+// the next one.
+class LateResampler
+{
+public:
+    // 1 (the late reverb runs at the full rate), 2 or 4, resets the filters
+    void setFactor(int newFactor);
+    int getFactor() const;
+    void reset();
+    // the delay of the late output in samples at the full rate
+    int getLatency() const;
+
+    // processes numSamples samples of mix, which has the io interface of fv3::zrev2::processio() at the full sample
+    // rate, with the late reverb at the lower sample rate
+    template <class Mix>
+    void process(fv3::zrev2_f& reverb, Mix& mix, int numSamples)
+    {
+        if (factor == 1)
+        {
+            reverb.processio(mix, numSamples);
+            return;
+        }
+
+        ResampledIO<Mix> io{*this, mix, static_cast<int>(reverb.getnumoutputs())};
+        const int numLateSamples = (phase + numSamples) / factor;
+        const int numSamplesInGroups = numLateSamples > 0 ? numLateSamples * factor - phase : 0;
+        reverb.processio(io, numLateSamples);
+        for (int i = numSamplesInGroups; i < numSamples; ++i)
+            io.mixSample();
+    }
+
+private:
+    static constexpr int maxFactor = 4;
+    int factor = 1;
+    // the number of samples of the current group which are already mixed
+    int phase = 0;
+    float leftInput[maxFactor];
+    float rightInput[maxFactor];
+    // the late output for the samples of the current group
+    float output[maxFactor][FV3_ZREV2_MAX_OUTPUTS];
+    // stage 0 is between the full and the half sample rate, stage 1 between the half and the quarter sample rate
+    HalfBandFilter leftDecimators[2];
+    HalfBandFilter rightDecimators[2];
+    HalfBandFilter interpolators[2][FV3_ZREV2_MAX_OUTPUTS];
+
+    inline float decimate(const float* input, HalfBandFilter* decimators)
+    {
+        if (factor == 2)
+            return decimators[0].decimate(input[0], input[1]);
+        const float first = decimators[0].decimate(input[0], input[1]);
+        const float second = decimators[0].decimate(input[2], input[3]);
+        return decimators[1].decimate(first, second);
+    }
+
+    inline void interpolate(const float* lateOutput, int numOutputs)
+    {
+        for (int c = 0; c < numOutputs; ++c)
+        {
+            if (factor == 2)
+                interpolators[0][c].interpolate(lateOutput[c], output[0][c], output[1][c]);
+            else
+            {
+                float first, second;
+                interpolators[1][c].interpolate(lateOutput[c], first, second);
+                interpolators[0][c].interpolate(first, output[0][c], output[1][c]);
+                interpolators[0][c].interpolate(second, output[2][c], output[3][c]);
+            }
+        }
+    }
+
+    // the io of the late reverb at the lower sample rate, each late sample mixes a group of full rate samples
+    template <class Mix>
+    struct ResampledIO
+    {
+        LateResampler& resampler;
+        Mix& mix;
+        int numOutputs;
+
+        inline void mixSample()
+        {
+            const int i = resampler.phase++;
+            mix.read(resampler.leftInput[i], resampler.rightInput[i]);
+            mix.write(resampler.output[i]);
+        }
+
+        inline void read(float& left, float& right)
+        {
+            while (resampler.phase < resampler.factor)
+                mixSample();
+            resampler.phase = 0;
+            left = resampler.decimate(resampler.leftInput, resampler.leftDecimators);
+            right = resampler.decimate(resampler.rightInput, resampler.rightDecimators);
+        }
+
+        inline void write(const float* lateOutput)
+        {
+            resampler.interpolate(lateOutput, numOutputs);
+        }
+    };
+};
@@ -0,0 +1,103 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParameterSmoother.h"
+#include <cmath>
+
+ParameterSmoother::ParameterSmoother(Type newType, float newRampTime)
+    : type(newType), rampTime(newRampTime)
+{
+}
+
+void ParameterSmoother::reset(float sampleRate)
+{
+    // a running ramp can't be continued at another sample rate
+    rampLength = static_cast<int>(rampTime * sampleRate);
+    setCurrentAndTargetValue(targetValue);
+}
+
+void ParameterSmoother::setTargetValue(float newTargetValue)
+{
+    if (newTargetValue == targetValue)
+        return;
+
+    targetValue = newTargetValue;
+    if (rampLength <= 0 || currentValue == targetValue)
+    {
+        setCurrentAndTargetValue(targetValue);
+        return;
+    }
+
+    // a new target starts a new ramp of the full length from the current value
+    samplesLeft = rampLength;
+    multiplicative = type == Type::exponential && currentValue > 0.0f && targetValue > 0.0f;
+    if (multiplicative)
+        step = std::pow(targetValue / currentValue, 1.0f / static_cast<float>(rampLength));
+    else
+        step = (targetValue - currentValue) / static_cast<float>(rampLength);
+}
+
+void ParameterSmoother::setCurrentAndTargetValue(float newValue)
+{
+    currentValue = newValue;
+    targetValue = newValue;
+    samplesLeft = 0;
+}
+
+float ParameterSmoother::getCurrentValue() const
+{
+    return currentValue;
+}
+
+float ParameterSmoother::getTargetValue() const
+{
+    return targetValue;
+}
+
+bool ParameterSmoother::isSmoothing() const
+{
+    return samplesLeft > 0;
+}
+
+float ParameterSmoother::advance(int numSamples)
+{
+    if (samplesLeft <= 0)
+        return currentValue;
+
+    // the last step ends exactly on the target, so there is no rounding error left
+    if (numSamples >= samplesLeft)
+    {
+        setCurrentAndTargetValue(targetValue);
+        return currentValue;
+    }
+
+    samplesLeft -= numSamples;
+    if (multiplicative)
+        currentValue *= std::pow(step, static_cast<float>(numSamples));
+    else
+        currentValue += step * static_cast<float>(numSamples);
+    return currentValue;
+}
+
+float ParameterSmoother::advanceBlock(int numSamples, float& increment)
+{
+    const float startValue = currentValue;
+    increment = samplesLeft > 0 ? (advance(numSamples) - startValue) / static_cast<float>(numSamples) : 0.0f;
+    return startValue;
+}
@@ -0,0 +1,58 @@
+/**
+ *  ElephantDSP.com Hall Reverb
+ *
+ *  Copyright (C) 2022 Christian Voigt
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+// Moves a parameter to a new target value within a fixed ramp time. The value is advanced by whole blocks, so gains can
+// be ramped linearly over a block and filter coefficients are only recomputed once per block.
+class ParameterSmoother
+{
+public:
+    enum class Type
+    {
+        linear,     // constant increment per sample, for levels
+        exponential // constant ratio per sample, for frequencies and times (linear if a value is <= 0)
+    };
+
+    ParameterSmoother(Type newType, float newRampTime);
+
+    void reset(float sampleRate);
+    void setTargetValue(float newTargetValue);
+    void setCurrentAndTargetValue(float newValue);
+
+    float getCurrentValue() const;
+    float getTargetValue() const;
+    bool isSmoothing() const;
+
+    // moves the current value numSamples samples along the ramp and returns it
+    float advance(int numSamples);
+    // returns the current value and advances it by numSamples, increment is set to the per sample increment of a linear
+    // ramp from the returned value to the new current value
+    float advanceBlock(int numSamples, float& increment);
+
+private:
+    Type type;
+    float rampTime;
+    int rampLength = 0;
+    float currentValue = 0.0f;
+    float targetValue = 0.0f;
+    bool multiplicative = false;
+    float step = 0.0f; // increment or ratio per sample
+    int samplesLeft = 0;
+};
@@ -19,6 +19,25 @@
 
 #include "PluginProcessor.h"
 
+namespace
+{
+// the reverb's layout of a multichannel bus, mono and stereo buses use the stereo process()
+bool getMultichannelLayout(const juce::AudioChannelSet& channelSet, HallReverb::ChannelLayout& layout)
+{
+    if (channelSet == juce::AudioChannelSet::quadraphonic())
+        layout = HallReverb::ChannelLayout::quad;
+    else if (channelSet == juce::AudioChannelSet::create5point1())
+        layout = HallReverb::ChannelLayout::surround51;
+    else if (channelSet == juce::AudioChannelSet::create7point1())
+        layout = HallReverb::ChannelLayout::surround71;
+    else if (channelSet == juce::AudioChannelSet::ambisonic(1))
+        layout = HallReverb::ChannelLayout::ambisonic;
+    else
+        return false;
+    return true;
+}
+} // namespace
+
 ReverbAudioProcessor::ReverbAudioProcessor()
         :
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -34,37 +53,22 @@ ReverbAudioProcessor::ReverbAudioProcessor()
 #endif
           parameters(*this, &undo, "parameters", createParameterLayout())
 {
-    // add a listener for each parameter
-    parameters.addParameterListener("dryLevel", this);
-    parameters.addParameterListener("earlyLevel", this);
-    parameters.addParameterListener("earlySendLevel", this);
-    parameters.addParameterListener("lateLevel", this);
-    parameters.addParameterListener("earlyOutputHPF", this);
-    parameters.addParameterListener("earlyOutputLPF", this);
-    parameters.addParameterListener("earlyRoomSize", this);
-    parameters.addParameterListener("earlyStereoWidth", this);
-    parameters.addParameterListener("lateApFeedback", this);
-    parameters.addParameterListener("lateCrossOverFreqHigh", this);
-    parameters.addParameterListener("lateCrossOverFreqLow", this);
-    parameters.addParameterListener("lateDecay", this);
-    parameters.addParameterListener("lateDecayFactorHigh", this);
-    parameters.addParameterListener("lateDecayFactorLow", this);
-    parameters.addParameterListener("lateDiffusion", this);
-    parameters.addParameterListener("lateLFO1Freq", this);
-    parameters.addParameterListener("lateLFO2Freq", this);
-    parameters.addParameterListener("lateLFOFactor", this);
-    parameters.addParameterListener("lateOutputHPF", this);
-    parameters.addParameterListener("lateOutputLPF", this);
-    parameters.addParameterListener("latePredelay", this);
-    parameters.addParameterListener("lateRoomSize", this);
-    parameters.addParameterListener("lateSpin", this);
-    parameters.addParameterListener("lateSpinFactor", this);
-    parameters.addParameterListener("lateStereoWidth", this);
-    parameters.addParameterListener("lateWander", this);
+    // the parameters are bound to the reverb's parameters by index, their names are the same
+    for (int index = 0; index < HallReverb::numParameters; ++index)
+    {
+        reverbParameters[static_cast<size_t>(index)] =
+            parameters.getRawParameterValue(HallReverb::getParameterName(static_cast<HallReverb::Parameter>(index)));
+        jassert(reverbParameters[static_cast<size_t>(index)] != nullptr);
+    }
+
+#if HALLREVERB_ENABLE_PROFILING
+    reverb.setProfilingEnabled(true);
+#endif
 }
 
 ReverbAudioProcessor::~ReverbAudioProcessor()
 {
+    cancelPendingUpdate();
 }
 
 //==============================================================================
@@ -102,7 +106,8 @@ bool ReverbAudioProcessor::isMidiEffect() const
 
 double ReverbAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // follows the decay, predelay and room size parameters, the reverb has no latency
+    return reverb.getTailLengthSeconds();
 }
 
 int ReverbAudioProcessor::getNumPrograms()
@@ -141,7 +146,13 @@ void ReverbAudioProcessor::prepareToPlay(double sampleRate, int samplesPerBlock)
     // Use this method as the place to do any pre-playback
     // initialisation that you need..
     juce::ignoreUnused(samplesPerBlock);
+    updateReverbParameters();
+    reverb.setLateDownsampling(HALLREVERB_DOWNSAMPLE_LATE != 0);
     reverb.setSampleRate(sampleRate);
+    reverb.setMonoInput(getTotalNumInputChannels() == 1);
+    auto channelLayout = HallReverb::ChannelLayout::stereo;
+    getMultichannelLayout(getChannelLayoutOfBus(false, 0), channelLayout);
+    reverb.setChannelLayout(channelLayout);
 }
 
 void ReverbAudioProcessor::releaseResources()
@@ -149,6 +160,19 @@ void ReverbAudioProcessor::releaseResources()
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
     reverb.mute();
+
+#if HALLREVERB_ENABLE_PROFILING
+    const auto profile = reverb.getProfile();
+    if (profile.numSamples > 0)
+    {
+        const auto numSamples = static_cast<double>(profile.numSamples);
+        DBG("HallReverb profile [ns/sample]:"
+            << " input peak " << static_cast<double>(profile.inputPeak) / numSamples
+            << ", early " << static_cast<double>(profile.early) / numSamples
+            << ", late and mix " << static_cast<double>(profile.late) / numSamples
+            << ", bypass " << static_cast<double>(profile.bypass) / numSamples);
+    }
+#endif
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -159,17 +183,22 @@ bool ReverbAudioProcessor::isBusesLayoutSupported(
     juce::ignoreUnused(layouts);
     return true;
 #else
+    // surround and ambisonic buses are processed by one reverb with a decorrelated late output per channel
+    auto multichannelLayout = HallReverb::ChannelLayout::stereo;
+    if (getMultichannelLayout(layouts.getMainOutputChannelSet(), multichannelLayout))
+        return layouts.getMainInputChannelSet() == layouts.getMainOutputChannelSet();
+
     // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
+    // Otherwise the output is stereo, since the reverb always produces two channels.
     // Some plugin hosts, such as certain GarageBand versions, will only
     // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono() &&
-        layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 
-        // This checks if the input layout matches the output layout
 #if !JucePlugin_IsSynth
-    if (layouts.getMainOutputChannelSet() != layouts.getMainInputChannelSet())
+    // A mono input feeds both sides of the reverb (see HallReverb::setMonoInput())
+    if (layouts.getMainInputChannelSet() != juce::AudioChannelSet::mono() &&
+        layouts.getMainInputChannelSet() != juce::AudioChannelSet::stereo())
         return false;
 #endif
 
@@ -184,9 +213,11 @@ void ReverbAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
     juce::ignoreUnused(midiMessages);
 
     juce::ScopedNoDenormals noDenormals;
+    updateReverbParameters();
     auto totalNumInputChannels = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
+    // the reverb processes the buffer in place
     if (totalNumInputChannels == 1 && totalNumOutputChannels == 2)
     {
         // mono in, stereo out
@@ -201,6 +232,12 @@ void ReverbAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
                        buffer.getWritePointer(0), buffer.getWritePointer(1),
                        buffer.getNumSamples());
     }
+    else if (reverb.getChannelLayout() != HallReverb::ChannelLayout::stereo &&
+             totalNumOutputChannels == HallReverb::getNumChannels(reverb.getChannelLayout()))
+    {
+        // surround or ambisonics, all channels in place
+        reverb.process(buffer.getArrayOfWritePointers(), buffer.getNumSamples());
+    }
     else
     {
         jassertfalse; // channel layout not supported
@@ -221,20 +258,34 @@ juce::AudioProcessorEditor* ReverbAudioProcessor::createEditor()
 //==============================================================================
 void ReverbAudioProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
-    // You should use this method to store your parameters in the memory block.
-    // You could do that either as raw data, or use the XML or ValueTree classes
-    // as intermediaries to make it easy to save and load complex data.
-    auto state = parameters.copyState();
-    std::unique_ptr<juce::XmlElement> xml(state.createXml());
-    copyXmlToBinary(*xml, destData);
+    // the state is the reverb's binary state
+    updateReverbParameters();
+    destData.setSize(static_cast<size_t>(HallReverb::stateSize));
+    reverb.getState(destData.getData(), HallReverb::stateSize);
 }
 
 void ReverbAudioProcessor::setStateInformation(const void* data,
                                                int sizeInBytes)
 {
-    // You should use this method to restore your parameters from this memory
-    // block, whose contents will have been created by the getStateInformation()
-    // call.
+    // The parameters of the plugin are updated before the reverb, otherwise the audio thread's
+    // updateReverbParameters() would hand their old values back to the reverb while they are updated. The reverb gets
+    // the new values from them, as rounded to the parameter steps.
+    std::array<float, HallReverb::numParameters> values;
+    for (size_t index = 0; index < values.size(); ++index)
+        values[index] = reverbParameters[index]->load(std::memory_order_relaxed);
+    if (HallReverb::readState(data, sizeInBytes, values.data()))
+    {
+        for (int index = 0; index < HallReverb::numParameters; ++index)
+        {
+            const auto parameter = static_cast<HallReverb::Parameter>(index);
+            if (auto* plugParameter = parameters.getParameter(HallReverb::getParameterName(parameter)))
+                plugParameter->setValueNotifyingHost(plugParameter->convertTo0to1(values[static_cast<size_t>(index)]));
+        }
+        updateReverbParameters();
+        return;
+    }
+
+    // states saved before the binary state are XML
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
 
     if (xmlState.get() != nullptr)
@@ -242,6 +293,43 @@ void ReverbAudioProcessor::setStateInformation(const void* data,
             parameters.replaceState(juce::ValueTree::fromXml(*xmlState));
 }
 
+void ReverbAudioProcessor::updateReverbParameters()
+{
+    // Only changed parameters are handed to the reverb. The reverb's latest values are compared instead of values kept
+    // here, so this may be called from any thread (e.g. getStateInformation() while processing).
+    bool changed = false;
+    for (int index = 0; index < HallReverb::numParameters; ++index)
+    {
+        const auto parameter = static_cast<HallReverb::Parameter>(index);
+        const float newValue = reverbParameters[static_cast<size_t>(index)]->load(std::memory_order_relaxed);
+        if (newValue != reverb.getParameter(parameter))
+        {
+            reverb.setParameter(parameter, newValue);
+            changed = true;
+        }
+    }
+
+    // the tail follows the decay, predelay and room size parameters, the host is told when it changes
+    if (changed)
+    {
+        const double tailLength = reverb.getTailLengthSeconds();
+        if (reportedTailLength.exchange(tailLength, std::memory_order_relaxed) != tailLength)
+            triggerAsyncUpdate();
+    }
+}
+
+void ReverbAudioProcessor::handleAsyncUpdate()
+{
+    // getTailLengthSeconds() changed, the latency is always 0
+    updateHostDisplay(juce::AudioProcessorListener::ChangeDetails().withLatencyChanged(false));
+}
+
+//==============================================================================
+HallReverb::Profile ReverbAudioProcessor::getReverbProfile() const
+{
+    return reverb.getProfile();
+}
+
 //==============================================================================
 // This creates new instances of the plugin..
 juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -262,7 +350,7 @@ ReverbAudioProcessor::createParameterLayout()
 
     params.add(std::make_unique<juce::AudioParameterFloat>("earlyOutputHPF", "earlyOutputHPF", Range{0.0f, 16000.0f, 1.0f}, 4.0f, " Hz"));
     params.add(std::make_unique<juce::AudioParameterFloat>("earlyOutputLPF", "earlyOutputLPF", Range{0.0f, 16000.0f, 1.0f}, 16000.0f, " Hz"));
-    params.add(std::make_unique<juce::AudioParameterFloat>("earlyRoomSize", "earlyRoomSize", Range{0.4f, 3.6f, 0.1f}, 0.5f, ""));
+    params.add(std::make_unique<juce::AudioParameterFloat>("earlyRoomSize", "earlyRoomSize", Range{0.4f, HallReverb::maxRoomSize, 0.1f}, 0.5f, ""));
     params.add(std::make_unique<juce::AudioParameterFloat>("earlyStereoWidth", "earlyStereoWidth", Range{-1.0f, 1.0f, 0.01f}, 1.0f, ""));
 
     params.add(std::make_unique<juce::AudioParameterFloat>("lateApFeedback", "lateApFeedback", Range{-1.0f, 1.0f, 0.01f}, 0.63f, ""));
@@ -278,7 +366,7 @@ ReverbAudioProcessor::createParameterLayout()
     params.add(std::make_unique<juce::AudioParameterFloat>("lateOutputHPF", "lateOutputHPF", Range{0.0f, 16000.0f, 1.0f}, 4.0f, " Hz"));
     params.add(std::make_unique<juce::AudioParameterFloat>("lateOutputLPF", "lateOutputLPF", Range{0.0f, 16000.0f, 1.0f}, 16000.0f, " Hz"));
     params.add(std::make_unique<juce::AudioParameterFloat>("latePredelay", "latePredelay", Range{0.0f, 200.0f, 0.1f}, 8.0f, " ms"));
-    params.add(std::make_unique<juce::AudioParameterFloat>("lateRoomSize", "lateRoomSize", Range{0.4f, 3.6f, 0.1f}, 0.5f, ""));
+    params.add(std::make_unique<juce::AudioParameterFloat>("lateRoomSize", "lateRoomSize", Range{0.4f, HallReverb::maxRoomSize, 0.1f}, 0.5f, ""));
     params.add(std::make_unique<juce::AudioParameterFloat>("lateSpin", "lateSpin", Range{0.0f, 50.0f, 0.1f}, 2.4f, " Hz"));
     params.add(std::make_unique<juce::AudioParameterFloat>("lateSpinFactor", "lateSpinFactor", Range{0.0f, 1.0f, 0.01f}, 0.3f, ""));
     params.add(std::make_unique<juce::AudioParameterFloat>("lateStereoWidth", "lateStereoWidth", Range{-1.0f, 1.0f, 0.01f}, 1.0f, ""));
@@ -286,115 +374,3 @@ ReverbAudioProcessor::createParameterLayout()
 
     return params;
 }
-
-void ReverbAudioProcessor::parameterChanged(const juce::String& parameter, float newValue)
-{
-    if (parameter == "dryLevel")
-    {
-        reverb.setDryLevel(newValue);
-    }
-    else if (parameter == "earlyLevel")
-    {
-        reverb.setEarlyLevel(newValue);
-    }
-    else if (parameter == "earlySendLevel")
-    {
-        reverb.setEarlySendLevel(newValue);
-    }
-    else if (parameter == "lateLevel")
-    {
-        reverb.setLateLevel(newValue);
-    }
-    else if (parameter == "earlyOutputHPF")
-    {
-        reverb.setEarlyOutputHPF(newValue);
-    }
-    else if (parameter == "earlyOutputLPF")
-    {
-        reverb.setEarlyOutputLPF(newValue);
-    }
-    else if (parameter == "earlyRoomSize")
-    {
-        reverb.setEarlyRoomSize(newValue);
-    }
-    else if (parameter == "earlyStereoWidth")
-    {
-        reverb.setEarlyStereoWidth(newValue);
-    }
-    else if (parameter == "lateApFeedback")
-    {
-        reverb.setLateApFeedback(newValue);
-    }
-    else if (parameter == "lateCrossOverFreqHigh")
-    {
-        reverb.setLateCrossOverFreqHigh(newValue);
-    }
-    else if (parameter == "lateCrossOverFreqLow")
-    {
-        reverb.setLateCrossOverFreqLow(newValue);
-    }
-    else if (parameter == "lateDecay")
-    {
-        reverb.setLateDecay(newValue);
-    }
-    else if (parameter == "lateDecayFactorHigh")
-    {
-        reverb.setLateDecayFactorHigh(newValue);
-    }
-    else if (parameter == "lateDecayFactorLow")
-    {
-        reverb.setLateDecayFactorLow(newValue);
-    }
-    else if (parameter == "lateDiffusion")
-    {
-        reverb.setLateDiffusion(newValue);
-    }
-    else if (parameter == "lateLFO1Freq")
-    {
-        reverb.setLateLFO1Freq(newValue);
-    }
-    else if (parameter == "lateLFO2Freq")
-    {
-        reverb.setLateLFO2Freq(newValue);
-    }
-    else if (parameter == "lateLFOFactor")
-    {
-        reverb.setLateLFOFactor(newValue);
-    }
-    else if (parameter == "lateOutputHPF")
-    {
-        reverb.setLateOutputHPF(newValue);
-    }
-    else if (parameter == "lateOutputLPF")
-    {
-        reverb.setLateOutputLPF(newValue);
-    }
-    else if (parameter == "latePredelay")
-    {
-        reverb.setLatePredelay(newValue);
-    }
-    else if (parameter == "lateRoomSize")
-    {
-        reverb.setLateRoomSize(newValue);
-    }
-    else if (parameter == "lateSpin")
-    {
-        reverb.setLateSpin(newValue);
-    }
-    else if (parameter == "lateSpinFactor")
-    {
-        reverb.setLateSpinFactor(newValue);
-    }
-    else if (parameter == "lateStereoWidth")
-    {
-        reverb.setLateStereoWidth(newValue);
-    }
-    else if (parameter == "lateWander")
-    {
-        reverb.setLateWander(newValue);
-    }
-    else
-    {
-        jassertfalse; // unknown parameter ...
-    }
-}
@@ -20,9 +20,11 @@
 #pragma once
 
 #include "HallReverb.h"
+#include <array>
+#include <atomic>
 #include <juce_audio_processors/juce_audio_processors.h>
 
-class ReverbAudioProcessor : public juce::AudioProcessor, public juce::AudioProcessorValueTreeState::Listener
+class ReverbAudioProcessor : public juce::AudioProcessor, private juce::AsyncUpdater
 {
 public:
     //==============================================================================
@@ -64,8 +66,7 @@ public:
     void setStateInformation(const void* data, int sizeInBytes) override;
 
     //==============================================================================
-    void parameterChanged(const juce::String& parameter,
-                          float newValue) override;
+    HallReverb::Profile getReverbProfile() const;
 
     //==============================================================================
 
@@ -76,6 +77,12 @@ private:
     juce::ValueTree applicationState{"application"};
     juce::AudioProcessorValueTreeState parameters;
     HallReverb reverb;
+    // the values of the plugin parameters in the order of HallReverb::Parameter, read once per block
+    std::array<std::atomic<float>*, HallReverb::numParameters> reverbParameters{};
+    void updateReverbParameters();
+    // the tail length last reported to the host, a change is reported from the message thread
+    std::atomic<double> reportedTailLength{0.0};
+    void handleAsyncUpdate() override;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ReverbAudioProcessor)
 };